@@ -0,0 +1,170 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+#include "PhaserArena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+	#include <malloc.h>
+#else
+	#include <sys/mman.h>
+#endif
+
+PhaserArena::PhaserArena(int32_t numBlocks) :
+	myBlocks(new Block[numBlocks]),
+	myNumBlocks(numBlocks),
+	myBytesReserved(0),
+	myNumAllocations(0)
+{
+	for (int32_t i = 0; i < myNumBlocks; i++)
+	{
+		myBlocks[i] = { nullptr, 0, 0, false };
+	}
+}
+
+PhaserArena::~PhaserArena()
+{
+	for (int32_t i = 0; i < myNumBlocks; i++)
+	{
+		release(myBlocks[i].data, myBlocks[i].hugePages);
+	}
+	delete[] myBlocks;
+}
+
+void*
+PhaserArena::getBytes(int32_t index, size_t bytes)
+{
+	assert(index >= 0 && index < myNumBlocks);
+	Block& block = myBlocks[index];
+
+	block.lastRequest = bytes;
+	if (bytes > block.capacity)
+	{
+		// Growing means the old contents are stale anyway, so they aren't copied.
+		reallocate(block, bytes, false);
+	}
+	return block.data;
+}
+
+void
+PhaserArena::trim()
+{
+	for (int32_t i = 0; i < myNumBlocks; i++)
+	{
+		Block& block = myBlocks[i];
+		if (block.lastRequest < block.capacity)
+		{
+			reallocate(block, block.lastRequest, true);
+		}
+	}
+}
+
+void
+PhaserArena::reallocate(Block& block, size_t bytes, bool keepContents)
+{
+	bool hugePages = false;
+	void* data = bytes ? allocate(bytes, hugePages) : nullptr;
+
+	if (data)
+	{
+		myNumAllocations++;
+		if (keepContents && block.data)
+		{
+			memcpy(data, block.data, std::min(bytes, block.capacity));
+		}
+	}
+
+	release(block.data, block.hugePages);
+	myBytesReserved -= block.capacity;
+
+	block.data = data;
+	block.capacity = data ? bytes : 0;
+	block.hugePages = hugePages;
+	myBytesReserved += block.capacity;
+}
+
+void*
+PhaserArena::allocate(size_t bytes, bool& hugePages)
+{
+	hugePages = false;
+
+#ifdef _WIN32
+	if (bytes >= HugePageThreshold)
+	{
+		// Large pages need the "Lock pages in memory" privilege, so fall back
+		// to regular pages when they can't be had.
+		SIZE_T largePage = GetLargePageMinimum();
+		if (largePage)
+		{
+			SIZE_T rounded = (bytes + largePage - 1) / largePage * largePage;
+			void* data = VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (data)
+			{
+				hugePages = true;
+				return data;
+			}
+		}
+	}
+	return _aligned_malloc(bytes, Alignment);
+#else
+	size_t alignment = Alignment;
+	#ifdef MADV_HUGEPAGE
+	const size_t hugePageSize = 2 << 20;
+	if (bytes >= HugePageThreshold)
+	{
+		alignment = hugePageSize;
+		bytes = (bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+	}
+	#endif
+
+	void* data = nullptr;
+	if (posix_memalign(&data, alignment, bytes) != 0)
+	{
+		return nullptr;
+	}
+
+	#ifdef MADV_HUGEPAGE
+	if (alignment == hugePageSize)
+	{
+		// Transparent huge pages are only a hint, the memory is usable either way.
+		madvise(data, bytes, MADV_HUGEPAGE);
+	}
+	#endif
+	return data;
+#endif
+}
+
+void
+PhaserArena::release(void* data, [[maybe_unused]] bool hugePages)
+{
+	if (!data)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	if (hugePages)
+	{
+		VirtualFree(data, 0, MEM_RELEASE);
+	}
+	else
+	{
+		_aligned_free(data);
+	}
+#else
+	free(data);
+#endif
+}
@@ -0,0 +1,86 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+
+ A per-instance memory arena for the scratch buffers and tables of a PhaserCHOP.
+
+ Each block is 64-byte aligned and grows to the largest size ever requested
+ from it (its high-water mark). Once every block has reached its high-water
+ mark, get() never touches the heap again, so steady-state cooks are
+ allocation free. Memory is only given back when trim() is called.
+
+ Blocks of at least HugePageThreshold bytes are backed by huge pages where the
+ OS allows it.
+
+ */
+class PhaserArena
+{
+public:
+	PhaserArena(int32_t numBlocks);
+	~PhaserArena();
+
+	PhaserArena(const PhaserArena&) = delete;
+	PhaserArena& operator=(const PhaserArena&) = delete;
+
+	// Returns room for 'count' elements in 'block'. The contents of the block
+	// are kept as long as 'count' fits in what the block already holds.
+	template <typename T>
+	T*
+	get(int32_t block, size_t count)
+	{
+		return static_cast<T*>(getBytes(block, count * sizeof(T)));
+	}
+
+	// The current memory of 'block', without requesting any. Pointers from
+	// get() don't survive trim(), so data kept across cooks is looked up here.
+	template <typename T>
+	T*
+	data(int32_t block) const
+	{
+		return static_cast<T*>(myBlocks[block].data);
+	}
+
+	// Shrinks every block down to what was last requested from it, keeping its contents.
+	void		trim();
+
+	size_t		bytesReserved() const { return myBytesReserved; }
+
+	// The number of heap allocations made since the arena was created.
+	int64_t		numAllocations() const { return myNumAllocations; }
+
+	static const size_t Alignment = 64;
+	static const size_t HugePageThreshold = 8 << 20;
+
+private:
+	struct Block
+	{
+		void*	data;
+		size_t	capacity;
+		size_t	lastRequest;
+		bool	hugePages;
+	};
+
+	void*		getBytes(int32_t block, size_t bytes);
+	void		reallocate(Block& block, size_t bytes, bool keepContents);
+
+	static void* allocate(size_t bytes, bool& hugePages);
+	static void	release(void* data, bool hugePages);
+
+	Block*		myBlocks;
+	int32_t		myNumBlocks;
+	size_t		myBytesReserved;
+	int64_t		myNumAllocations;
+};
@@ -17,6 +17,104 @@
 
 #include <string>
 #include <algorithm>    // std::max
+#include <random>
+#include <chrono>
+
+#include "PhaserTrace.h"
+
+using PhaserKernels::Span;
+using PhaserKernels::Edges;
+
+// Seeds the hash of rank phases, which is made from the hash of their keys.
+static const uint64_t RankHashSeed = 0x52616e6b;
+
+// Runs the level of detail kernel of a block, hierarchical if there are group phases.
+template <typename Phase, typename Decode>
+static void
+evaluateLod(double t, Span<const float> groupPhases, double groupEdge,
+	Span<const Phase> phases, Edges edges, Span<float> out, int32_t step, Decode decode)
+{
+	if (groupPhases.data)
+	{
+		PhaserKernels::hierarchicalLod(t, groupPhases, groupEdge, phases, edges, out, step, decode);
+	}
+	else
+	{
+		PhaserKernels::coefficientLod(t, phases, edges, out, step, decode);
+	}
+}
+
+// Runs the kernel that fits the settings over values j to j + n of phase
+// channel i. 'phases' and 'groupPhases' hold the whole channel, and
+// 'groupPhases' is empty for channels outside a hierarchy.
+static void
+evaluateBlock(double t, PHASER_PhaseStorage storage, const PhaserPhaseTable* table, int32_t i, int32_t j,
+	Span<const float> phases, Span<const float> groupPhases, double groupEdge, int32_t lod,
+	Edges blockEdges, Span<float> blockValues)
+{
+	const int32_t n = blockValues.size;
+	const Span<const float> blockGroupPhases = groupPhases.data ? groupPhases.subspan(j, n) : Span<const float>();
+	const Span<const uint16_t> codes = table ? Span<const uint16_t>(table->codes(i) + j, n) : Span<const uint16_t>();
+
+	if (lod > 1)
+	{
+		switch (storage)
+		{
+			case PHASER_PhaseStorage::Unorm16:
+				evaluateLod(t, blockGroupPhases, groupEdge, codes, blockEdges, blockValues, lod, PhaserKernels::decodeUnorm16);
+				break;
+			case PHASER_PhaseStorage::Half16:
+				evaluateLod(t, blockGroupPhases, groupEdge, codes, blockEdges, blockValues, lod, PhaserKernels::decodeHalf16);
+				break;
+			default:
+				evaluateLod(t, blockGroupPhases, groupEdge, phases.subspan(j, n),
+					blockEdges, blockValues, lod, [](float phase) { return phase; });
+				break;
+		}
+	}
+	else if (blockGroupPhases.data)
+	{
+		switch (storage)
+		{
+			case PHASER_PhaseStorage::Unorm16:
+				PhaserKernels::hierarchicalUnorm16(t, blockGroupPhases, groupEdge, codes, blockEdges, blockValues);
+				break;
+			case PHASER_PhaseStorage::Half16:
+				PhaserKernels::hierarchicalHalf16(t, blockGroupPhases, groupEdge, codes, blockEdges, blockValues);
+				break;
+			default:
+				PhaserKernels::hierarchical(t, blockGroupPhases, groupEdge, phases.subspan(j, n), blockEdges, blockValues);
+				break;
+		}
+	}
+	else
+	{
+		switch (storage)
+		{
+			case PHASER_PhaseStorage::Unorm16:
+				PhaserKernels::coefficientUnorm16(t, codes, blockEdges, blockValues);
+				break;
+			case PHASER_PhaseStorage::Half16:
+				PhaserKernels::coefficientHalf16(t, codes, blockEdges, blockValues);
+				break;
+			default:
+				PhaserKernels::coefficient(t, phases.subspan(j, n), blockEdges, blockValues);
+				break;
+		}
+	}
+}
+
+// Returns the index of the channel of 'input' called 'name', or -1.
+static int32_t
+findChannel(const OP_CHOPInput* input, const char* name)
+{
+	for (int32_t i = 0; input && i < input->numChannels; i++)
+	{
+		if (strcmp(input->getChannelName(i), name) == 0)
+			return i;
+	}
+	return -1;
+}
 
 
 // These functions are basic C function, which the DLL loader can find
@@ -74,8 +172,13 @@ DestroyCHOPInstance(CHOP_CPlusPlusBase* instance)
 };
 
 
-PhaserCHOP::PhaserCHOP(const OP_NodeInfo* info) : myNodeInfo(info), myRamp(0.)
+constexpr double PhaserCHOP::smallestDouble;
+constexpr int32_t PhaserCHOP::ReduceSamples;
+constexpr int32_t PhaserCHOP::MaxLod;
+
+PhaserCHOP::PhaserCHOP(const OP_NodeInfo* info) : myNodeInfo(info), myClock(0.), myArena(PHASER_NumArenaBlocks)
 {
+	std::fill(myInfoValues, myInfoValues + PHASER_NumInfoChans, 0.f);
 }
 
 PhaserCHOP::~PhaserCHOP()
@@ -86,6 +189,23 @@ void
 PhaserCHOP::getGeneralInfo(CHOP_GeneralInfo* ginfo, const OP_Inputs* inputs, void* reserved1)
 {
 	ginfo->cookEveryFrameIfAsked = true;
+
+	// With Smart Cook the node only cooks every frame while the internal clock
+	// is running. Otherwise it only cooks when its inputs or parameters change,
+	// which a wired pct already does whenever it moves.
+	if (inputs->getParInt("Smartcook"))
+	{
+		const OP_CHOPInput* timeInput = inputs->getInputCHOP(0);
+		const bool clockStopped = (PHASER_ClockMode)inputs->getParInt("Clockmode") == PHASER_ClockMode::Once &&
+			myClock >= 1. && !myClockReset;
+		ginfo->cookEveryFrameIfAsked = !timeInput && !clockStopped;
+	}
+
+	// Keep cooking until a background rebuild has been swapped in.
+	if (myRankWorker.pending())
+	{
+		ginfo->cookEveryFrameIfAsked = true;
+	}
 	ginfo->timeslice = false;
 	ginfo->inputMatchIndex = 1;
 }
@@ -93,9 +213,12 @@ PhaserCHOP::getGeneralInfo(CHOP_GeneralInfo* ginfo, const OP_Inputs* inputs, voi
 bool
 PhaserCHOP::getOutputInfo(CHOP_OutputInfo* info, const OP_Inputs* inputs, void* reserved1)
 {
+	PHASER_TRACE_SCOPE("getOutputInfo");
+
 	const OP_CHOPInput* phaseInput = inputs->getInputCHOP(1);
 
 	PHASER_OutputFormat myOutputFormat = (PHASER_OutputFormat)inputs->getParDouble("Outputformat");
+	const PHASER_OutputGroups groups(inputs);
 
 	switch (myOutputFormat)
 	{
@@ -104,12 +227,19 @@ PhaserCHOP::getOutputInfo(CHOP_OutputInfo* info, const OP_Inputs* inputs, void*
 			return false;
 			break;
 		case PHASER_OutputFormat::Onechannel:
-			if (phaseInput) {
+			if (phaseInput && groups.count == 1) {
 				// return false and copy the samples/channels of the phaseInput
 				return false;
 			}
+			else if (phaseInput) {
+				info->numChannels = phaseInput->numChannels * groups.count;
+				info->numSamples = phaseInput->numSamples;
+				info->startIndex = phaseInput->startIndex;
+				info->sampleRate = (float)phaseInput->sampleRate;
+				return true;
+			}
 			else {
-				info->numChannels = 1;
+				info->numChannels = groups.count;
 				info->numSamples = inputs->getParDouble("Nsamples");
 				info->startIndex = 0;
 				//info->sampleRate = 60.f; // todo sample rate
@@ -120,18 +250,28 @@ PhaserCHOP::getOutputInfo(CHOP_OutputInfo* info, const OP_Inputs* inputs, void*
 			// swap samples to channels and channels to samples
 			if (phaseInput) {
 				info->numChannels = phaseInput->numSamples;
-				info->numSamples = phaseInput->numChannels;
+				info->numSamples = phaseInput->numChannels * groups.count;
 				info->startIndex = phaseInput->startIndex;
 			}
 			else {
 			// swap samples to channels and channels to samples
 				info->numChannels = inputs->getParDouble("Nsamples");
-				info->numSamples = 1;
+				info->numSamples = groups.count;
 				info->startIndex = 0;
 				//info->sampleRate = 60.f; // todo sample rate
 			}
 			return true;
 			break;
+		case PHASER_OutputFormat::Tiled:
+		{
+			const int64_t numValues = phaseInput ? (int64_t)phaseInput->numChannels * phaseInput->numSamples :
+				(int64_t)inputs->getParDouble("Nsamples");
+			const PHASER_Tiling tiling(inputs, numValues);
+			info->numChannels = tiling.width * groups.count;
+			info->numSamples = tiling.height;
+			info->startIndex = 0;
+			return true;
+		}
 		default:
 			myError = "Unexpected Output Format";
 			return false;
@@ -142,230 +282,2251 @@ PhaserCHOP::getOutputInfo(CHOP_OutputInfo* info, const OP_Inputs* inputs, void*
 void
 PhaserCHOP::getChannelName(int32_t index, OP_String* name, const OP_Inputs* inputs, void* reserved1)
 {
-	 name->setString("chan1");
-}
+	const OP_CHOPInput* phaseInput = inputs->getInputCHOP(1);
+	PHASER_OutputFormat myOutputFormat = (PHASER_OutputFormat)inputs->getParDouble("Outputformat");
 
-float
-PhaserCHOP::clamp(double val, double lower, double upper)
-{
-	return val <= lower ? lower : val >= upper ? upper : val;
-	// return std::max(std::min(val, upper), lower); // alternative equivalent version
-}
-
-// An alternative easing function.
-// A typical easing function called "ease" takes a value "t" from [0,1] and returns another value [0,1]
-// where ease(0)=0, ease(1)=1.
-// Imagine we have multiple unique objects that are being animated from 0 to 1 and then processed through "ease".
-// We may want to stagger the way in which these objects go through "ease", and this is why we use the "phaser" function.
-// Phaser takes an additional argument called "phase", which is from [0,1]. A value of 1 corresponds to an animated object that
-// "ahead of the pack"; It will start animating before others. A value of 0 for phase corresponds to an object that is late; It
-// will be the last to start moving. The "edge" parameter describes the cohesiveness of the pack of animated objects; A small value
-// will cause the objects to go through the animation very differently, or very sharply. A small value is a sharper edge.
-// The output of the phaser function will be [0,1], so these values can then be passed to any other easing function, perhaps "smoothstep",
-// or "ease-in-out".
-float
-PhaserCHOP::phaser(double t, double _phase, double edge)
-{
-	// safety checks because phase must be [0-1].
-	float phase = clamp(_phase, 0., 1.);
-	// but we will assume t has been clamped to [0,1] before entering this function.
-	// We will also assume edge is greater than and not equal to 0.
+	if (myOutputFormat == PHASER_OutputFormat::Multichannels)
+	{
+		// One channel per phase sample, named from a table that is only
+		// rebuilt when the count or the scheme changes.
+		const int32_t numChannels = phaseInput ? phaseInput->numSamples : (int32_t)inputs->getParDouble("Nsamples");
+		myChannelNames.update((PHASER_ChannelNames)inputs->getParInt("Channelnames"),
+			inputs->getParString("Nameprefix"), inputs->getParDAT("Namedat"), numChannels);
+		name->setString(index < myChannelNames.count() ? myChannelNames.name(index) : "chan1");
+		return;
+	}
 
-	// smaller edge corresponds to sharper separation according
-	// to differences in phase
-	return clamp((-1. + phase + t*(1. + edge)) / edge, 0., 1.);
-}
+	if (myOutputFormat == PHASER_OutputFormat::Tiled)
+	{
+		// The names repeat for each output group, with its suffix.
+		const PHASER_OutputGroups groups(inputs);
+		const int64_t numValues = phaseInput ? (int64_t)phaseInput->numChannels * phaseInput->numSamples :
+			(int64_t)inputs->getParDouble("Nsamples");
+		const PHASER_Tiling tiling(inputs, numValues);
+		myChannelNames.update((PHASER_ChannelNames)inputs->getParInt("Channelnames"),
+			inputs->getParString("Nameprefix"), inputs->getParDAT("Namedat"), tiling.width);
 
-void
-PhaserCHOP::execute(CHOP_Output* output,
-	const OP_Inputs* inputs,
-	void* reserved)
-{
-	// remove errors
-	myError = "";
+		std::string channelName = myChannelNames.name(index % tiling.width);
+		channelName += groups.suffix(index / tiling.width);
+		name->setString(channelName.c_str());
+		return;
+	}
 
-	myRamp = fmod(myRamp + (1. / 60.)/4., 1.); // basic LFO ramp over 4 seconds
+	if (myOutputFormat != PHASER_OutputFormat::Onechannel)
+	{
+		name->setString("chan1");
+		return;
+	}
 
-	// Edge can't be zero. We'll rely on the Parameter settings to prevent this.
-	double Edge = inputs->getParDouble("Edge");
-	Edge = std::max(smallestDouble, Edge);
-	int numInputs = inputs->getNumInputs();
+	// Each group repeats the phase channel names with its own suffix.
+	const PHASER_OutputGroups groups(inputs);
+	const int32_t numPhaseChannels = phaseInput ? phaseInput->numChannels : 1;
 
-	const OP_CHOPInput* timeInput = inputs->getInputCHOP(0);
-	const OP_CHOPInput* phaseInput = inputs->getInputCHOP(1);
-	const OP_CHOPInput* edgeInput = inputs->getInputCHOP(2);
+	std::string channelName = phaseInput ? phaseInput->getChannelName(index % numPhaseChannels) : "chan1";
+	channelName += groups.suffix(index / numPhaseChannels);
+	name->setString(channelName.c_str());
+}
 
-	bool canGetEdge = false;
-	if (edgeInput && edgeInput->numSamples > 0 && edgeInput->numChannels > 0)
+PHASER_OutputGroups::PHASER_OutputGroups(const OP_Inputs* inputs)
+{
+	if (inputs->getParInt("Timechannels"))
 	{
-		canGetEdge = true;
+		startTime = count++;
+		endTime = count++;
+	}
+	if (inputs->getParInt("Velocitychannels"))
+	{
+		velocity = count++;
 	}
+}
+
+const char*
+PHASER_OutputGroups::suffix(int32_t group) const
+{
+	if (group == startTime)
+		return "_tstart";
+	if (group == endTime)
+		return "_tend";
+	if (group == velocity)
+		return "_vel";
+	return "";
+}
 
-	double t = 0.;
-	if (timeInput && timeInput->numChannels > 0 && timeInput->numSamples > 0)
+PHASER_Tiling::PHASER_Tiling(const OP_Inputs* inputs, int64_t numValues)
+{
+	// A size of 0 is worked out from the other one.
+	const int32_t w = inputs->getParInt("Tilewidth");
+	const int32_t h = inputs->getParInt("Tileheight");
+	numValues = std::max<int64_t>(numValues, 1);
+	if (w > 0)
 	{
-		// Get the latest sample in the time input because PhaserCHOP doesn't
-		// yet support timeslicing.
-		t = timeInput->getChannelData(0)[timeInput->numSamples - 1];
-		t = clamp(t, 0., 1.);
+		width = w;
+		height = h > 0 ? h : (int32_t)((numValues + w - 1) / w);
 	}
 	else
 	{
-		t = myRamp;
+		height = h > 0 ? h : 1;
+		width = (int32_t)((numValues + height - 1) / height);
 	}
 
-	PHASER_OutputFormat myOutputFormat = (PHASER_OutputFormat)inputs->getParDouble("Outputformat");
-
-	int numChannels, numSamples;
+	columnMajor = inputs->getParInt("Tileorder") == 1;
+	serpentine = inputs->getParInt("Serpentine") != 0;
+}
 
-	if (phaseInput) {
-		numChannels = phaseInput->numChannels;
-		numSamples = phaseInput->numSamples;
+bool
+PHASER_Speculation::hits(const PHASER_Speculation& other) const
+{
+	if (phasesHash != other.phasesHash || edge != other.edge || groupEdge != other.groupEdge ||
+		storage != other.storage || numChannels != other.numChannels || numSamples != other.numSamples ||
+		groupChannel != other.groupChannel || lod != other.lod || tiled != other.tiled ||
+		tileWidth != other.tileWidth || tileHeight != other.tileHeight || columnMajor != other.columnMajor)
+	{
+		return false;
 	}
-	else {
-		numChannels = 1;
-		numSamples = inputs->getParDouble("Nsamples");
+
+	// The values move at most this fast with t, and a miss by less than half
+	// a float ulp at 1 doesn't show.
+	double slope = (1. + edge) / edge;
+	if (groupChannel >= 0)
+	{
+		slope *= (1. + groupEdge) / groupEdge;
 	}
+	return fabs(t - other.t) * slope <= std::ldexp(1., -25);
+}
+
+int32_t
+PHASER_Tiling::contiguous(int64_t k) const
+{
+	if (columnMajor || k >= (int64_t)width * height)
+		return 0;
+	return height - (int32_t)(k % height);
+}
+
+bool
+PHASER_Tiling::reversed(int64_t k) const
+{
+	return serpentine && !columnMajor && (k / height) % 2 == 1;
+}
 
-	float phase = 0.f;
-	float result = 0.f;
+float*
+PHASER_Tiling::address(int64_t k, int32_t n, float* const* channels, int32_t group) const
+{
+	float* channel = channels[group * width + (int32_t)(k / height)];
+	const int32_t sample = (int32_t)(k % height);
+	return reversed(k) ? channel + height - sample - n : channel + sample;
+}
 
-	for (int j = 0; j < numSamples; j++)
+void
+PHASER_Tiling::store(Span<const float> values, int64_t k, float* const* channels, int32_t group) const
+{
+	float* const* groupChannels = channels + group * width;
+	const int64_t end = std::min<int64_t>(k + values.size, (int64_t)width * height);
+	for (int64_t v = k; v < end; v++)
 	{
-		for (int i = 0; i < numChannels; i++)
+		// 'major' is the channel in row major order and the sample in column major.
+		const int32_t major = (int32_t)(v / (columnMajor ? width : height));
+		int32_t minor = (int32_t)(v % (columnMajor ? width : height));
+		if (serpentine && major % 2 == 1)
 		{
-			if (canGetEdge)
-			{
-				Edge = edgeInput->getChannelData(std::min(i, edgeInput->numChannels-1))[std::min(j, edgeInput->numSamples - 1)];
+			minor = (columnMajor ? width : height) - 1 - minor;
+		}
 
-				// Edge must be greater than zero.
-				Edge = std::max(smallestDouble, Edge);
-			}
+		if (columnMajor)
+			groupChannels[minor][major] = values[(int32_t)(v - k)];
+		else
+			groupChannels[major][minor] = values[(int32_t)(v - k)];
+	}
+}
 
-			if (phaseInput)
-			{
-				phase = phaseInput->getChannelData(i)[j];
-			}
-			else
-			{
-				// Rely on the N samples parameter and make a descending ramp of phase samples.
-				// Question: what if the ramp is only 1 sample? Then pick 0.5 rather than 0 or 1.
-				phase = numSamples > 1 ? 1. - (double)j / (double)(numSamples - 1) : 0.5;
-			}
+void
+PHASER_Tiling::clear(int64_t numValues, float* const* channels, int32_t group) const
+{
+	const int64_t capacity = (int64_t)width * height;
+	const float zeros[256] = {};
+	for (int64_t v = numValues; v < capacity; v += 256)
+	{
+		const int32_t n = (int32_t)std::min<int64_t>(256, capacity - v);
+		store(Span<const float>(zeros, n), v, channels, group);
+	}
+}
 
-			result = phaser(t, phase, Edge);
+float
+PhaserCHOP::clamp(double val, double lower, double upper)
+{
+	return PhaserKernels::clamp(val, lower, upper);
+}
 
-			switch (myOutputFormat)
-			{
-				case PHASER_OutputFormat::Invalid:
-					// don't write to output.
-					break;
-				case PHASER_OutputFormat::Onechannel:
-					output->channels[i][j] = result;
-					break;
-				case PHASER_OutputFormat::Multichannels:
-					// swap samples to channels and channels to samples
-					output->channels[j][i] = result;
-					break;
-				default:
-					// don't write to output.
-					break;
-			}
-		}
-	}
+float
+PhaserCHOP::phaser(double t, double phase, double edge)
+{
+	return PhaserKernels::phaser(t, phase, edge);
 }
 
-int32_t
-PhaserCHOP::getNumInfoCHOPChans(void* reserved1)
+static float
+roundTripUnorm16(float phase)
 {
-	return 0;
+	return PhaserKernels::decodeUnorm16(PhaserKernels::encodeUnorm16(phase));
 }
 
-void
-PhaserCHOP::getInfoCHOPChan(int32_t index,
-	OP_InfoCHOPChan* chan,
-	void* reserved1)
+static float
+roundTripHalf16(float phase)
 {
+	return PhaserKernels::decodeHalf16(PhaserKernels::encodeHalf16(phase));
 }
 
-bool		
-PhaserCHOP::getInfoDATSize(OP_InfoDATSize* infoSize, void* reserved1)
+// Float phase versions of the hierarchical 16-bit kernels, for verification.
+// Like PhaserKernels::encoded, they encode a chunk at a time.
+template <uint16_t (*Encode)(float),
+	void (*Evaluate)(double, Span<const float>, double, Span<const uint16_t>, Edges, Span<float>)>
+static void
+hierarchicalEncoded(double t, Span<const float> groupPhases, double groupEdge,
+	Span<const float> phases, Edges edges, Span<float> out)
 {
-	infoSize->rows = 0;
-	infoSize->cols = 0;
-	// Setting this to false means we'll be assigning values to the table
-	// one row at a time. True means we'll do it one column at a time.
-	infoSize->byColumn = false;
-	return true;
+	uint16_t codes[256];
+	for (int32_t start = 0; start < out.size; start += 256)
+	{
+		const int32_t count = std::min(256, out.size - start);
+		for (int32_t i = 0; i < count; i++)
+			codes[i] = Encode(phases[start + i]);
+		Evaluate(t, groupPhases.subspan(start, count), groupEdge, Span<const uint16_t>(codes, count),
+			edges.subspan(start), out.subspan(start, count));
+	}
 }
 
-void
-PhaserCHOP::getInfoDATEntries(int32_t index,
-	int32_t nEntries,
-	OP_InfoDATEntries* entries,
-	void* reserved1)
+// Maps a float onto a monotonic integer line so that the difference of two
+// mapped values is their distance in ULPs.
+static int64_t
+orderedFloatBits(float f)
 {
+	int32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits < 0 ? (int64_t)INT32_MIN - bits : bits;
 }
 
 void
-PhaserCHOP::setupParameters(OP_ParameterManager* manager, void* reserved1)
+PhaserCHOP::runVerification()
 {
-	// Edge
+	struct Variant
 	{
-		OP_NumericParameter	np;
+		const char* name;
+		PhaserKernels::Kernel	kernel;
+		int64_t		maxUlp;
 
-		np.name = "Edge";
-		np.label = "Edge";
-		np.defaultValues[0] = 1.0;
-		np.minSliders[0] = smallestDouble;
-		np.maxSliders[0] =  10.0;
+		// Variants that store phases in a lossy format are compared against the
+		// reference evaluated on the decoded phases, so only the kernel math is checked.
+		float		(*roundTrip)(float);
+	};
 
-		np.clampMins[0] = true;
-		np.minValues[0] = smallestDouble;
-		
-		OP_ParAppendResult res = manager->appendFloat(np);
-		assert(res == OP_ParAppendResult::Success);
+	// Register every optimized kernel here along with the error it may have
+	// relative to PhaserKernels::reference.
+	const Variant variants[] =
+	{
+		{ "coefficient", PhaserKernels::coefficient, 1, nullptr },
+		{ "unorm16", PhaserKernels::unorm16, 1, roundTripUnorm16 },
+		{ "half16", PhaserKernels::half16, 1, roundTripHalf16 },
+	};
+
+	// Hierarchical kernels are checked against the composition
+	// phaser(phaser(t, groupPhase, groupEdge), phase, edge). Each level may be
+	// off by an ulp, so they are allowed two.
+	struct HierarchicalVariant
+	{
+		const char* name;
+		void		(*kernel)(double, Span<const float>, double, Span<const float>, Edges, Span<float>);
+		int64_t		maxUlp;
+		float		(*roundTrip)(float);
+	};
+
+	const HierarchicalVariant hierarchicalVariants[] =
+	{
+		{ "hierarchical", PhaserKernels::hierarchical, 2, nullptr },
+		{ "hierarchical_unorm16", hierarchicalEncoded<PhaserKernels::encodeUnorm16, PhaserKernels::hierarchicalUnorm16>,
+			2, roundTripUnorm16 },
+		{ "hierarchical_half16", hierarchicalEncoded<PhaserKernels::encodeHalf16, PhaserKernels::hierarchicalHalf16>,
+			2, roundTripHalf16 },
+	};
+
+	// Randomized inputs first, then adversarial ones: edges at and around the
+	// smallest allowed edge, phases outside of [0,1], t exactly 0 and 1, and NaN.
+	const int32_t numRandom = 1 << 16;
+	std::vector<double> times;
+	std::vector<float> phases, edges;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<double> unit(0., 1.);
+	for (int32_t i = 0; i < numRandom; i++)
+	{
+		times.push_back(unit(rng));
+		phases.push_back((float)(unit(rng) * 2. - .5));
+		edges.push_back((float)std::pow(2., unit(rng) * 20. - 16.));
 	}
 
-	// Number of samples:
-	// This parameter only matters when phase samples isn't wired in.
+	const double specialTimes[] = { 0., 1., .5, 1e-9, 1. - 1e-9, std::numeric_limits<double>::quiet_NaN() };
+	const float specialPhases[] = { 0.f, 1.f, -0.f, -1.f, 2.f, .5f, 1e-7f, 1.f - 6e-8f,
+		std::numeric_limits<float>::denorm_min(), std::numeric_limits<float>::quiet_NaN() };
+	const float specialEdges[] = { (float)smallestDouble, std::nextafter((float)smallestDouble, 1.f),
+		std::nextafter((float)smallestDouble, 0.f), 0.f, -1.f, 1.f, 10.f, 1e6f,
+		std::numeric_limits<float>::quiet_NaN() };
+
+	for (double t : specialTimes)
 	{
-		OP_NumericParameter	np;
+		for (float phase : specialPhases)
+		{
+			for (float edge : specialEdges)
+			{
+				times.push_back(t);
+				phases.push_back(phase);
+				edges.push_back(edge);
+			}
+		}
+	}
 
-		np.name = "Nsamples";
-		np.label = "N Samples";
-		np.defaultValues[0] = 10.0;
-		np.minSliders[0] = 0;
-		np.maxSliders[0] = 10.;
+	const int32_t numSamples = (int32_t)phases.size();
+	std::vector<float> expected(numSamples), actual(numSamples);
 
-		np.clampMins[0] = true;
-		np.minValues[0] = 0;
+	// Longer than a few of the 256 sample chunks the 16-bit kernels encode,
+	// and not a multiple of them.
+	const int32_t spanSamples = 1000;
 
-		OP_ParAppendResult res = manager->appendInt(np);
-		assert(res == OP_ParAppendResult::Success);
+	// Group phases for the hierarchical kernels, in runs of up to 16 samples
+	// that each take the phase of a random test sample, adversarial ones too.
+	std::vector<float> groupPhases(numSamples);
+	std::uniform_int_distribution<int32_t> runLength(1, 16);
+	std::uniform_int_distribution<int32_t> anySample(0, numSamples - 1);
+	for (int32_t i = 0; i < numSamples;)
+	{
+		const float groupPhase = phases[anySample(rng)];
+		for (int32_t end = std::min(numSamples, i + runLength(rng)); i < end; i++)
+			groupPhases[i] = groupPhase;
 	}
 
-	// Output Format:
-	// First option is do nothing and copy info of phase samples input.
-	// Second option is equivalent to shuffle chop swap channels and samples.
+	myVerifyReport.clear();
+
+	auto record = [](VerifyResult& result, float expected, float actual)
 	{
-		OP_StringParameter	sp;
+		result.numSamples++;
+		if (std::isnan(expected) || std::isnan(actual))
+		{
+			if (std::isnan(expected) != std::isnan(actual))
+				result.nanMismatches++;
+			return;
+		}
+		result.maxAbsError = std::max(result.maxAbsError, (double)std::fabs(expected - actual));
+		result.maxUlpError = std::max(result.maxUlpError, std::abs(orderedFloatBits(expected) - orderedFloatBits(actual)));
+	};
 
-		sp.name = "Outputformat";
-		sp.label = "Output Format";
+	for (const Variant& variant : variants)
+	{
+		VerifyResult result = { variant.name, 0, 0., 0, 0, true };
 
-		sp.defaultValue = "Onechannel";
+		// Each sample is checked twice, once with a per-sample edge span
+		// and once with a scalar edge.
+		for (int32_t i = 0; i < numSamples; i++)
+		{
+			double scalarEdge = std::max(smallestDouble, (double)edges[i]);
 
-		const char* names[] = { "Onechannel", "Multichannels" };
-		const char* labels[] = { "One Channel", "Multi-Channels" };
+			float referencePhase = variant.roundTrip ? variant.roundTrip(phases[i]) : phases[i];
 
-		OP_ParAppendResult res = manager->appendMenu(sp, 2, names, labels);
-		assert(res == OP_ParAppendResult::Success);
+			const PhaserKernels::Span<const float> referenceSpan(&referencePhase, 1);
+			const PhaserKernels::Span<const float> phaseSpan(&phases[i], 1);
+			const PhaserKernels::Edges edgeSpan(&edges[i], 0.);
+
+			PhaserKernels::reference(times[i], referenceSpan, edgeSpan, PhaserKernels::Span<float>(&expected[i], 1));
+			variant.kernel(times[i], phaseSpan, edgeSpan, PhaserKernels::Span<float>(&actual[i], 1));
+
+			float expectedScalar, actualScalar;
+			PhaserKernels::reference(times[i], referenceSpan, scalarEdge, PhaserKernels::Span<float>(&expectedScalar, 1));
+			variant.kernel(times[i], phaseSpan, scalarEdge, PhaserKernels::Span<float>(&actualScalar, 1));
+
+			record(result, expected[i], actual[i]);
+			record(result, expectedScalar, actualScalar);
+		}
+
+		// Then whole spans, which go through the loops that hoist the scalar
+		// edge and encode a chunk at a time. Each span takes the t and scalar
+		// edge of its first sample.
+		for (int32_t start = 0; start < numSamples; start += spanSamples)
+		{
+			const int32_t n = std::min(spanSamples, numSamples - start);
+			const double t = times[start];
+			const double scalarEdge = std::max(smallestDouble, (double)edges[start]);
+			const Span<const float> phaseSpan(&phases[start], n);
+			const Edges edgeSpan(&edges[start], 0.);
+
+			variant.kernel(t, phaseSpan, edgeSpan, Span<float>(&actual[start], n));
+			for (int32_t i = 0; i < n; i++)
+			{
+				const float referencePhase = variant.roundTrip ? variant.roundTrip(phases[start + i]) : phases[start + i];
+				record(result, PhaserKernels::phaser(t, referencePhase, edgeSpan.at(i)), actual[start + i]);
+			}
+
+			variant.kernel(t, phaseSpan, scalarEdge, Span<float>(&actual[start], n));
+			for (int32_t i = 0; i < n; i++)
+			{
+				const float referencePhase = variant.roundTrip ? variant.roundTrip(phases[start + i]) : phases[start + i];
+				record(result, PhaserKernels::phaser(t, referencePhase, scalarEdge), actual[start + i]);
+			}
+		}
+
+		result.passed = result.nanMismatches == 0 && result.maxUlpError <= variant.maxUlp;
+		myVerifyReport.push_back(result);
 	}
-}
 
-void 
-PhaserCHOP::pulsePressed(const char* name, void* reserved1)
-{
+	for (const HierarchicalVariant& variant : hierarchicalVariants)
+	{
+		VerifyResult result = { variant.name, 0, 0., 0, 0, true };
+
+		// The group phase and edge of each sample are taken from the next one.
+		for (int32_t i = 0; i < numSamples; i++)
+		{
+			const int32_t g = (i + 1) % numSamples;
+			const double groupEdge = std::max(smallestDouble, (double)edges[g]);
+			const double scalarEdge = std::max(smallestDouble, (double)edges[i]);
+			const float referencePhase = variant.roundTrip ? variant.roundTrip(phases[i]) : phases[i];
+
+			const double progress = PhaserKernels::phaser(times[i], phases[g], groupEdge);
+			const float expectedSpan = PhaserKernels::phaser(progress, referencePhase,
+				PhaserKernels::Edges(&edges[i], 0.).at(0));
+			const float expectedScalar = PhaserKernels::phaser(progress, referencePhase, scalarEdge);
+
+			float actualSpan, actualScalar;
+			const Span<const float> groupSpan(&phases[g], 1);
+			const Span<const float> phaseSpan(&phases[i], 1);
+			variant.kernel(times[i], groupSpan, groupEdge, phaseSpan, Edges(&edges[i], 0.), Span<float>(&actualSpan, 1));
+			variant.kernel(times[i], groupSpan, groupEdge, phaseSpan, scalarEdge, Span<float>(&actualScalar, 1));
+
+			record(result, expectedSpan, actualSpan);
+			record(result, expectedScalar, actualScalar);
+		}
+
+		// Then whole spans of groups, runs of samples with the same group
+		// phase, for the kernels to reuse the group progress within a run.
+		for (int32_t start = 0; start < numSamples; start += spanSamples)
+		{
+			const int32_t n = std::min(spanSamples, numSamples - start);
+			const double t = times[start];
+			const double groupEdge = std::max(smallestDouble, (double)edges[(start + 1) % numSamples]);
+			const double scalarEdge = std::max(smallestDouble, (double)edges[start]);
+			const Span<const float> groupSpan(&groupPhases[start], n);
+			const Span<const float> phaseSpan(&phases[start], n);
+			const Edges edgeSpan(&edges[start], 0.);
+
+			for (int32_t scalar = 0; scalar < 2; scalar++)
+			{
+				variant.kernel(t, groupSpan, groupEdge, phaseSpan, scalar ? Edges(scalarEdge) : edgeSpan,
+					Span<float>(&actual[start], n));
+				for (int32_t i = 0; i < n; i++)
+				{
+					const float referencePhase = variant.roundTrip ? variant.roundTrip(phases[start + i]) : phases[start + i];
+					const double progress = PhaserKernels::phaser(t, groupSpan[i], groupEdge);
+					record(result, PhaserKernels::phaser(progress, referencePhase, scalar ? scalarEdge : edgeSpan.at(i)),
+						actual[start + i]);
+				}
+			}
+		}
+
+		result.passed = result.nanMismatches == 0 && result.maxUlpError <= variant.maxUlp;
+		myVerifyReport.push_back(result);
+	}
+
+	// LOD kernels evaluate every step-th sample of a block, and its last one,
+	// the same way as full detail and interpolate the others. Those samples
+	// must match the full detail result exactly. The blocks run over the
+	// inputs above, with the t, edge and group phase of their first sample.
+	const int32_t lodBlock = 61;
+	const int32_t lodStep = 4;
+	for (int32_t hierarchy = 0; hierarchy < 2; hierarchy++)
+	{
+		VerifyResult result = { hierarchy ? "hierarchical_lod" : "coefficient_lod", 0, 0., 0, 0, true };
+
+		for (int32_t start = 0; start + lodBlock <= numSamples; start += lodBlock)
+		{
+			const double t = times[start];
+			const double edge = std::max(smallestDouble, (double)edges[start]);
+			const std::vector<float> groupPhases(lodBlock, phases[start]);
+			const Span<const float> groupSpan = hierarchy ? Span<const float>(groupPhases.data(), lodBlock) : Span<const float>();
+			const Span<const float> phaseSpan(&phases[start], lodBlock);
+			const Span<float> full(&expected[start], lodBlock);
+			const Span<float> lod(&actual[start], lodBlock);
+
+			if (hierarchy)
+				PhaserKernels::hierarchical(t, groupSpan, edge, phaseSpan, edge, full);
+			else
+				PhaserKernels::coefficient(t, phaseSpan, edge, full);
+			evaluateLod(t, groupSpan, edge, phaseSpan, edge, lod, lodStep, [](float phase) { return phase; });
+
+			for (int32_t i = 0; i < lodBlock; i += lodStep)
+			{
+				record(result, full[i], lod[i]);
+			}
+			record(result, full[lodBlock - 1], lod[lodBlock - 1]);
+		}
+
+		result.passed = result.nanMismatches == 0 && result.maxUlpError == 0;
+		myVerifyReport.push_back(result);
+	}
+
+	// Turning Rank Phase off has to bring back a 16-bit table of the phases
+	// themselves, in the node that served the ranks and in a new node reading
+	// the same phases. Scratch nodes read a stand-in phase input for this.
+	const float* rankKeys = phases.data();
+	OP_CHOPInput rankInput = {};
+	rankInput.opPath = "";
+	rankInput.numChannels = 1;
+	rankInput.numSamples = std::min(numRandom, 2 * PhaserPhaseTable::ChunkSamples + 1);
+	rankInput.channelData = &rankKeys;
+
+	const PHASER_PhaseStorage rankStorages[] = { PHASER_PhaseStorage::Unorm16, PHASER_PhaseStorage::Half16 };
+	for (PHASER_PhaseStorage storage : rankStorages)
+	{
+		const bool unorm = storage == PHASER_PhaseStorage::Unorm16;
+		VerifyResult result = { unorm ? "rank_toggle_unorm16" : "rank_toggle_half16", 0, 0., 0, 0, true };
+
+		PhaserCHOP toggled(myNodeInfo);
+		toggled.updatePhaseTable(&rankInput, 1, rankInput.numSamples, storage, true, PHASER_Rebuild::Block);
+		toggled.updatePhaseTable(&rankInput, 1, rankInput.numSamples, storage, false, PHASER_Rebuild::Block);
+
+		PhaserCHOP fresh(myNodeInfo);
+		fresh.updatePhaseTable(&rankInput, 1, rankInput.numSamples, storage, false, PHASER_Rebuild::Block);
+
+		for (const PhaserCHOP* node : { &toggled, &fresh })
+		{
+			const uint16_t* codes = node->myPhaseTable->codes(0);
+			for (int32_t j = 0; j < rankInput.numSamples; j++)
+			{
+				const float phase = PhaserKernels::clamp(rankKeys[j], 0., 1.);
+				record(result, unorm ? roundTripUnorm16(phase) : roundTripHalf16(phase),
+					unorm ? PhaserKernels::decodeUnorm16(codes[j]) : PhaserKernels::decodeHalf16(codes[j]));
+			}
+		}
+
+		result.passed = result.nanMismatches == 0 && result.maxUlpError == 0;
+		myVerifyReport.push_back(result);
+	}
+}
+
+void
+PhaserCHOP::execute(CHOP_Output* output,
+	const OP_Inputs* inputs,
+	void* reserved)
+{
+	PHASER_TRACE_SCOPE("execute");
+
+#ifdef PHASER_TRACE
+	// Parameters can't be read in pulsePressed, so the path is kept for Write Trace.
+	const char* traceFile = inputs->getParString("Tracefile");
+	myTraceFile = traceFile ? traceFile : "";
+#endif
+
+	// remove errors
+	myError = "";
+
+	// Counts the arena blocks this cook had to grow. It stays at 0 in steady
+	// state. Allocations made outside the arena aren't counted.
+	const int64_t arenaGrowsBefore = myArena.numAllocations();
+
+	// The speculative cook reads arena blocks, so it is stopped before any
+	// of them can move. Whatever it didn't finish is a miss.
+	bool speculationReady = false;
+	if (mySpeculationWorker.pending())
+	{
+		mySpeculationCancel = true;
+		mySpeculationWorker.collect();
+		speculationReady = mySpeculationComplete;
+	}
+
+	myInfoValues[PHASER_InfoHashMs] = 0.f;
+	myInfoValues[PHASER_InfoTableBuildMs] = 0.f;
+	myInfoValues[PHASER_InfoRankSortMs] = 0.f;
+
+	// The internal clock keeps running while pct is wired.
+	const double clockT = advanceClock(inputs);
+
+	// Edge can't be zero. We'll rely on the Parameter settings to prevent this.
+	double Edge = inputs->getParDouble("Edge");
+	Edge = std::max(smallestDouble, Edge);
+	int numInputs = inputs->getNumInputs();
+
+	const OP_CHOPInput* phaseInput = inputs->getInputCHOP(1);
+	const OP_CHOPInput* edgeInput = inputs->getInputCHOP(2);
+
+	bool canGetEdge = false;
+	if (edgeInput && edgeInput->numSamples > 0 && edgeInput->numChannels > 0)
+	{
+		canGetEdge = true;
+	}
+
+	// Only hashes when the edge input has cooked.
+	updateContentHash(canGetEdge ? edgeInput : nullptr, myEdgeHash);
+
+	// A stage table replaces pct and Edge with those of the active stage,
+	// whose values are then mapped to its from/to range.
+	const bool staged = myStages.update(inputs->getParDAT("Stagedat"));
+
+	PHASER_OutputFormat myOutputFormat = (PHASER_OutputFormat)inputs->getParDouble("Outputformat");
+
+	myInfoDAT = (PHASER_InfoDAT)inputs->getParInt("Infodat");
+	myNumEvents = 0;
+	myNumChanged = 0;
+
+	int numChannels, numSamples;
+
+	if (phaseInput) {
+		numChannels = phaseInput->numChannels;
+		numSamples = phaseInput->numSamples;
+	}
+	else {
+		numChannels = 1;
+		numSamples = inputs->getParDouble("Nsamples");
+	}
+
+	if (myOutputFormat != PHASER_OutputFormat::Onechannel &&
+		myOutputFormat != PHASER_OutputFormat::Multichannels &&
+		myOutputFormat != PHASER_OutputFormat::Tiled)
+	{
+		// don't write to output.
+		return;
+	}
+
+	PHASER_PhaseStorage storage = (PHASER_PhaseStorage)inputs->getParDouble("Phasestorage");
+	if (storage != PHASER_PhaseStorage::Unorm16 && storage != PHASER_PhaseStorage::Half16)
+	{
+		storage = PHASER_PhaseStorage::Float32;
+	}
+
+	const bool rank = inputs->getParInt("Rankphase") != 0;
+	updatePhaseTable(phaseInput, numChannels, numSamples, storage, rank, (PHASER_Rebuild)inputs->getParInt("Rebuild"));
+
+	const int32_t numClocks = updateClocks(inputs, clockT, Edge, staged, numChannels);
+
+	// Only every lod-th sample is evaluated. Auto LOD raises it above the
+	// LOD parameter while evaluating the values misses its budget.
+	const int32_t minLod = std::max(1, std::min(MaxLod, (int32_t)inputs->getParInt("Lod")));
+	const bool autoLod = inputs->getParInt("Autolod") != 0;
+	const int32_t lod = autoLod ? std::max(myLod, minLod) : minLod;
+
+	// A hierarchical phaser staggers the groups by the phases of one channel,
+	// then the members of each group by the phases of the other channels.
+	const int32_t groupChannel = inputs->getParInt("Hierarchical") ?
+		findChannel(phaseInput, inputs->getParString("Groupphase")) : -1;
+	const double groupEdge = std::max(smallestDouble, inputs->getParDouble("Groupedge"));
+	const float groupSlope = (float)((1. + groupEdge) / groupEdge);
+
+	const PHASER_OutputGroups groups(inputs);
+	const bool multichannels = myOutputFormat == PHASER_OutputFormat::Multichannels;
+	const bool tiled = myOutputFormat == PHASER_OutputFormat::Tiled;
+	const PHASER_Tiling tiling(inputs, (int64_t)numChannels * numSamples);
+
+	// Every group is written below, so the output must be as large as
+	// getOutputInfo made it for these settings.
+	const int64_t neededChannels = multichannels ? numSamples : tiled ? (int64_t)tiling.width * groups.count :
+		(int64_t)numChannels * groups.count;
+	const int64_t neededSamples = multichannels ? (int64_t)numChannels * groups.count : tiled ? tiling.height : numSamples;
+	if (output->numChannels < neededChannels || output->numSamples < neededSamples)
+	{
+		myError = "Output is smaller than the phaser values";
+		return;
+	}
+
+	// Start and end times only depend on the phases and edges. The events
+	// are found from their sorted order.
+	const bool events = myInfoDAT == PHASER_InfoDAT::Events;
+	const size_t numTimes = groups.startTime >= 0 || events ? (size_t)numChannels * numSamples : 0;
+	bool timesStale = !myTimesValid || myTimesPhaseHash != myPhasesHash ||
+		myTimesEdgeHash != myEdgeHash.hash || myTimesGroupChannel != groupChannel ||
+		(groupChannel >= 0 && myTimesGroupEdge != groupEdge);
+	float* startTimes = myArena.get<float>(PHASER_BlockStartTimes, numTimes);
+	float* endTimes = myArena.get<float>(PHASER_BlockEndTimes, numTimes);
+
+	// Without an edge input, the times also depend on the edge of each
+	// channel's clock, which a stage can change.
+	double* timesEdges = myArena.get<double>(PHASER_BlockTimesEdges, numTimes && !canGetEdge ? numChannels : 0);
+	for (int32_t i = 0; timesEdges && i < numChannels; i++)
+	{
+		const double edge = myClocks[std::min(i, numClocks - 1)].edge;
+		timesStale = timesStale || timesEdges[i] != edge;
+		timesEdges[i] = edge;
+	}
+
+	myTimesValid = numTimes > 0;
+	myTimesPhaseHash = myPhasesHash;
+	myTimesEdgeHash = myEdgeHash.hash;
+	myTimesGroupChannel = groupChannel;
+	myTimesGroupEdge = groupEdge;
+
+	// Multichannels output swaps samples to channels, so each channel
+	// is evaluated into a row first and then scattered. Tiled output only
+	// goes through a row for the blocks it can't write in place.
+	const int32_t rowSamples = multichannels ? numSamples : tiled ? std::min(ReduceSamples, numSamples) : 0;
+	float* row = myArena.get<float>(PHASER_BlockRow, rowSamples);
+	float* velocityRow = myArena.get<float>(PHASER_BlockVelocityRow, groups.velocity >= 0 ? rowSamples : 0);
+
+	// If the edge input has fewer samples than the phase input, the last edge
+	// sample is repeated.
+	float* edgeRow = myArena.get<float>(PHASER_BlockEdgeRow,
+		canGetEdge && edgeInput->numSamples < numSamples ? numSamples : 0);
+
+	auto kernelStart = std::chrono::steady_clock::now();
+	// Only the evaluation itself depends on the LOD, so Auto LOD times just that.
+	std::chrono::steady_clock::duration evaluateTime(0);
+
+	int64_t finished = 0;
+	int64_t moving = 0;
+
+	// The change list compares against the values of the previous cook,
+	// everything changed if there are none.
+	const bool changes = myInfoDAT == PHASER_InfoDAT::Changes;
+	const size_t numChangeValues = changes ? (size_t)numChannels * numSamples : 0;
+	const bool previousValid = myPreviousValid && myNumPreviousValues == (int32_t)numChangeValues;
+	float* previousValues = myArena.get<float>(PHASER_BlockPreviousValues, numChangeValues);
+	myChangedIndices = myArena.get<int32_t>(PHASER_BlockChangedIndices, numChangeValues);
+	myChangedValues = myArena.get<float>(PHASER_BlockChangedValues, numChangeValues);
+
+	// Speculation needs a single clock and scalar edges, as the inputs can't
+	// be read once the cook is over.
+	const bool speculate = inputs->getParInt("Speculate") && numClocks == 1 && !canGetEdge;
+	PHASER_Speculation speculation;
+	speculation.phasesHash = myPhasesHash;
+	speculation.t = myClocks[0].t;
+	speculation.edge = myClocks[0].edge;
+	speculation.groupEdge = groupEdge;
+	speculation.storage = storage;
+	speculation.numChannels = numChannels;
+	speculation.numSamples = numSamples;
+	speculation.groupChannel = groupChannel;
+	speculation.lod = lod;
+	speculation.tiled = tiled;
+	speculation.tileWidth = tiling.width;
+	speculation.tileHeight = tiling.height;
+	speculation.columnMajor = tiling.columnMajor;
+
+	const bool speculated = speculate && speculationReady && speculation.hits(mySpeculation);
+	const float* speculatedValues = speculated ?
+		myArena.get<float>(PHASER_BlockSpeculationValues, (size_t)numChannels * numSamples) : nullptr;
+	if (speculate)
+	{
+		mySpeculationCooks++;
+		mySpeculationHits += speculated ? 1 : 0;
+	}
+	else
+	{
+		mySpeculationCooks = 0;
+		mySpeculationHits = 0;
+	}
+
+	for (int i = 0; i < numChannels; i++)
+	{
+		PHASER_TRACE_SCOPE("channel");
+		const PhaserStages::Active& clock = myClocks[std::min(i, numClocks - 1)];
+		const double t = clock.t;
+
+		const float* edges = nullptr;
+		if (canGetEdge)
+		{
+			const float* edgeChannel = edgeInput->getChannelData(std::min(i, edgeInput->numChannels - 1));
+			if (edgeInput->numSamples >= numSamples)
+			{
+				edges = edgeChannel;
+			}
+			else
+			{
+				for (int j = 0; j < numSamples; j++)
+				{
+					edgeRow[j] = edgeChannel[std::min(j, edgeInput->numSamples - 1)];
+				}
+				edges = edgeRow;
+			}
+		}
+
+		const Span<const float> phases(myPhaseChannels[i], numSamples);
+
+		// The group channel itself outputs the progress of each sample's group.
+		const bool member = groupChannel >= 0 && i != groupChannel;
+		const Edges channelEdges = i == groupChannel ? Edges(nullptr, groupEdge) : Edges(edges, clock.edge);
+		const Span<const float> groupPhases(member ? myPhaseChannels[groupChannel] : nullptr, member ? numSamples : 0);
+		const float velocityScale = (staged ? clock.velocityScale : 1.f) * (member ? groupSlope : 1.f);
+
+		// Tiled output picks the destination of each block below.
+		const Span<float> values(multichannels ? row : tiled ? nullptr : output->channels[i], numSamples);
+		Span<float> velocities;
+		if (groups.velocity >= 0 && !tiled)
+		{
+			velocities = Span<float>(multichannels ? velocityRow : output->channels[groups.velocity * numChannels + i], numSamples);
+		}
+
+		// The progress counts are taken block by block while the values are
+		// still in cache.
+		for (int32_t j = 0; j < numSamples; )
+		{
+			int32_t n = std::min(ReduceSamples, numSamples - j);
+			Span<float> blockValues;
+			Span<float> blockVelocities;
+
+			// Tiled blocks are cut where they leave an output channel, so the
+			// kernel writes them straight into place.
+			const int64_t k = (int64_t)i * numSamples + j;
+			const int32_t run = tiled ? tiling.contiguous(k) : 0;
+			if (!tiled)
+			{
+				blockValues = values.subspan(j, n);
+				if (velocities.data)
+					blockVelocities = velocities.subspan(j, n);
+			}
+			else if (run > 0)
+			{
+				n = std::min(n, run);
+				blockValues = Span<float>(tiling.address(k, n, output->channels, 0), n);
+				if (groups.velocity >= 0)
+					blockVelocities = Span<float>(tiling.address(k, n, output->channels, groups.velocity), n);
+			}
+			else
+			{
+				blockValues = Span<float>(row, n);
+				if (groups.velocity >= 0)
+					blockVelocities = Span<float>(velocityRow, n);
+			}
+
+			const Edges blockEdges = channelEdges.subspan(j);
+
+			if (speculated)
+			{
+				memcpy(blockValues.data, speculatedValues + k, n * sizeof(float));
+			}
+			else
+			{
+				const auto evaluateStart = std::chrono::steady_clock::now();
+				evaluateBlock(t, storage, myPhaseTable.get(), i, j, phases, groupPhases, groupEdge, lod, blockEdges, blockValues);
+				evaluateTime += std::chrono::steady_clock::now() - evaluateStart;
+			}
+
+			PhaserKernels::countProgress(blockValues, finished, moving);
+
+			if (blockVelocities.data)
+			{
+				PhaserKernels::velocities(blockValues, blockEdges, blockVelocities);
+				// Members also move at the speed of their group.
+				if (staged || member)
+				{
+					PhaserKernels::scale(blockVelocities, velocityScale, 0.f);
+				}
+			}
+
+			if (staged)
+			{
+				PhaserKernels::scale(blockValues, clock.range, clock.from);
+			}
+
+			if (changes)
+			{
+				const int32_t first = i * numSamples + j;
+				if (previousValid)
+				{
+					diffValues(blockValues.data, previousValues + first, first, n);
+				}
+				else
+				{
+					memcpy(previousValues + first, blockValues.data, n * sizeof(float));
+				}
+			}
+
+			if (tiled && run > 0 && tiling.reversed(k))
+			{
+				std::reverse(blockValues.data, blockValues.data + n);
+				if (blockVelocities.data)
+					std::reverse(blockVelocities.data, blockVelocities.data + n);
+			}
+			else if (tiled && run == 0)
+			{
+				tiling.store(blockValues, k, output->channels, 0);
+				if (blockVelocities.data)
+					tiling.store(blockVelocities, k, output->channels, groups.velocity);
+			}
+
+			j += n;
+		}
+
+		if (multichannels)
+		{
+			// swap samples to channels and channels to samples
+			PhaserKernels::scatter(values, output->channels, i);
+			if (velocities.data)
+			{
+				PhaserKernels::scatter(velocities, output->channels, groups.velocity * numChannels + i);
+			}
+		}
+
+		if (numTimes)
+		{
+			const Span<float> tstart(startTimes + (size_t)i * numSamples, numSamples);
+			const Span<float> tend(endTimes + (size_t)i * numSamples, numSamples);
+			if (timesStale)
+			{
+				PhaserKernels::startEndTimes(phases, channelEdges, tstart, tend);
+				if (member)
+				{
+					PhaserKernels::hierarchicalTimes(groupPhases, groupEdge, tstart, tend);
+				}
+			}
+
+			if (groups.startTime >= 0)
+			{
+				const int32_t startChannel = groups.startTime * numChannels + i;
+				const int32_t endChannel = groups.endTime * numChannels + i;
+				if (tiled)
+				{
+					tiling.store(tstart, (int64_t)i * numSamples, output->channels, groups.startTime);
+					tiling.store(tend, (int64_t)i * numSamples, output->channels, groups.endTime);
+				}
+				else if (multichannels)
+				{
+					PhaserKernels::scatter(tstart, output->channels, startChannel);
+					PhaserKernels::scatter(tend, output->channels, endChannel);
+				}
+				else
+				{
+					PhaserKernels::store(tstart, output->channels[startChannel], 1);
+					PhaserKernels::store(tend, output->channels[endChannel], 1);
+				}
+			}
+		}
+	}
+
+	std::chrono::duration<double, std::milli> kernelTime = std::chrono::steady_clock::now() - kernelStart;
+
+	// Auto LOD doubles the step while the evaluation misses its budget, and
+	// halves it once it would still fit with twice the work. A speculated cook
+	// didn't evaluate anything, so it keeps the LOD.
+	const double evaluateUs = std::chrono::duration<double, std::micro>(evaluateTime).count();
+	const double budgetUs = inputs->getParDouble("Lodbudget");
+	const bool adjustLod = autoLod && !speculated;
+	myLod = lod;
+	if (adjustLod && evaluateUs > budgetUs)
+	{
+		myLod = std::min(MaxLod, lod * 2);
+	}
+	else if (adjustLod && evaluateUs * 2. < budgetUs * LodRecovery)
+	{
+		myLod = std::max(minLod, lod / 2);
+	}
+
+	const int64_t numValues = (int64_t)numChannels * numSamples;
+
+	for (int32_t group = 0; tiled && group < groups.count; group++)
+	{
+		tiling.clear(numValues, output->channels, group);
+	}
+
+	if (events)
+	{
+		updateEvents(numClocks, startTimes, endTimes, numChannels, numSamples, timesStale);
+	}
+	else
+	{
+		myOrderValid = false;
+		myNumEventClocks = 0;
+	}
+
+	if (changes && !previousValid)
+	{
+		// Nothing to compare against, so every value is listed.
+		for (int32_t i = 0; i < (int32_t)numValues; i++)
+		{
+			myChangedIndices[i] = i;
+			myChangedValues[i] = previousValues[i];
+		}
+		myNumChanged = (int32_t)numValues;
+	}
+	myPreviousValid = changes;
+	myNumPreviousValues = (int32_t)numChangeValues;
+
+	startSpeculation(speculate ? &speculation : nullptr, phaseInput, rank, tiling);
+	const int32_t phaseBytes = storage == PHASER_PhaseStorage::Float32 ? sizeof(float) : sizeof(uint16_t);
+
+	myInfoValues[PHASER_InfoKernelMs] = (float)kernelTime.count();
+	myInfoValues[PHASER_InfoArenaBytes] = (float)myArena.bytesReserved();
+	myInfoValues[PHASER_InfoPhaseTableBytes] = myPhaseTable ? (float)myPhaseTable->bytes() : 0.f;
+	// The cache itself only holds a weak reference.
+	myInfoValues[PHASER_InfoPhaseTableUsers] = (float)myPhaseTable.use_count();
+	myInfoValues[PHASER_InfoSpuriousRecooks] = (float)mySpuriousRecooks;
+	myInfoValues[PHASER_InfoArenaGrows] = (float)(myArena.numAllocations() - arenaGrowsBefore);
+	myInfoValues[PHASER_InfoPhaseBytesPerSample] = (float)phaseBytes;
+	myInfoValues[PHASER_InfoPhaseBytesSaved] = (float)(numValues * (sizeof(float) - phaseBytes));
+	myInfoValues[PHASER_InfoPhaseMaxError] = myPhaseTable ? myPhaseTable->maxError() : 0.f;
+	// The phase error is magnified by 1/edge in the output. This bound is only
+	// known up front when the edge is a scalar.
+	double smallestEdge = Edge;
+	for (int32_t i = 0; i < numClocks; i++)
+	{
+		smallestEdge = std::min(smallestEdge, myClocks[i].edge);
+	}
+	myInfoValues[PHASER_InfoOutputMaxError] = canGetEdge ? -1.f :
+		(float)std::min(1., myInfoValues[PHASER_InfoPhaseMaxError] / smallestEdge);
+	myInfoValues[PHASER_InfoFinished] = (float)finished;
+	myInfoValues[PHASER_InfoMoving] = (float)moving;
+	myInfoValues[PHASER_InfoEvents] = (float)myNumEvents;
+	myInfoValues[PHASER_InfoChanged] = (float)myNumChanged;
+	myInfoValues[PHASER_InfoNameBuildMs] = (float)myChannelNames.buildMs();
+	myInfoValues[PHASER_InfoLod] = (float)lod;
+	myInfoValues[PHASER_InfoRebuildPending] = myRankWorker.pending() ? 1.f : 0.f;
+	myInfoValues[PHASER_InfoSpeculationHits] = (float)mySpeculationHits;
+	myInfoValues[PHASER_InfoSpeculationHitRate] = mySpeculationCooks ? (float)mySpeculationHits / mySpeculationCooks : 0.f;
+}
+
+void
+PhaserCHOP::diffValues(const float* values, float* previous, int32_t first, int32_t n)
+{
+	for (int32_t i = 0; i < n; i++)
+	{
+		// Bitwise, so a NaN that stays NaN isn't listed every cook.
+		if (memcmp(&values[i], &previous[i], sizeof(float)) != 0)
+		{
+			myChangedIndices[myNumChanged] = first + i;
+			myChangedValues[myNumChanged] = values[i];
+			myNumChanged++;
+			previous[i] = values[i];
+		}
+	}
+}
+
+void
+PhaserCHOP::startSpeculation(const PHASER_Speculation* current, const OP_CHOPInput* phaseInput, bool rank,
+	const PHASER_Tiling& tiling)
+{
+	PHASER_TRACE_SCOPE("startSpeculation");
+
+	// The first cook only has one t to go by.
+	const bool predictable = current && mySpeculationLastT >= 0.;
+	const double lastT = mySpeculationLastT;
+	mySpeculationLastT = current ? current->t : -1.;
+
+	const int32_t numChannels = predictable ? current->numChannels : 0;
+	const int32_t numSamples = predictable ? current->numSamples : 0;
+	const size_t numValues = (size_t)numChannels * numSamples;
+
+	// The phase input is only readable during the cook, so the job reads a
+	// copy of it, which is only made again when the phases change. The ramp
+	// and the ranks are held by the node already.
+	const bool copy = predictable && phaseInput && !rank &&
+		(current->storage == PHASER_PhaseStorage::Float32 || current->groupChannel >= 0);
+	float* values = myArena.get<float>(PHASER_BlockSpeculationValues, numValues);
+	float* phases = myArena.get<float>(PHASER_BlockSpeculationPhases, copy ? numValues : 0);
+	if (copy && (!mySpeculationPhasesValid || mySpeculationPhasesHash != current->phasesHash))
+	{
+		for (int32_t i = 0; i < numChannels; i++)
+		{
+			memcpy(phases + (size_t)i * numSamples, phaseInput->getChannelData(i), numSamples * sizeof(float));
+		}
+		mySpeculationPhasesHash = current->phasesHash;
+	}
+	mySpeculationPhasesValid = copy;
+
+	if (!predictable)
+		return;
+
+	PHASER_Speculation next = *current;
+	next.t = std::min(1., std::max(0., 2. * current->t - lastT));
+	mySpeculation = next;
+	mySpeculationCancel = false;
+	mySpeculationComplete = false;
+
+	mySpeculationJob.next = next;
+	mySpeculationJob.channels = phaseInput && !rank ? nullptr : myPhaseChannels;
+	mySpeculationJob.copied = copy ? phases : nullptr;
+	mySpeculationJob.table = myPhaseTable.get();
+	mySpeculationJob.values = values;
+	mySpeculationJob.tiling = tiling;
+	mySpeculationWorker.start(speculate, this);
+}
+
+void
+PhaserCHOP::speculate(void* self)
+{
+	PHASER_TRACE_SCOPE("speculation");
+
+	// Everything the job reads stays put until the next cook collects it.
+	PhaserCHOP* chop = static_cast<PhaserCHOP*>(self);
+	const PHASER_SpeculationJob& job = chop->mySpeculationJob;
+	const PHASER_Speculation& next = job.next;
+	const int32_t numSamples = next.numSamples;
+	auto channelPhases = [&job, numSamples](int32_t i)
+	{
+		const float* data = job.copied ? job.copied + (size_t)i * numSamples : job.channels ? job.channels[i] : nullptr;
+		return Span<const float>(data, data ? numSamples : 0);
+	};
+
+	// Same blocks as execute, since the LOD kernels interpolate within them.
+	for (int32_t i = 0; i < next.numChannels; i++)
+	{
+		const bool member = next.groupChannel >= 0 && i != next.groupChannel;
+		const Edges channelEdges(i == next.groupChannel ? next.groupEdge : next.edge);
+		const Span<const float> groupPhases = member ? channelPhases(next.groupChannel) : Span<const float>();
+
+		for (int32_t j = 0; j < numSamples; )
+		{
+			if (chop->mySpeculationCancel.load(std::memory_order_relaxed))
+				return;
+
+			int32_t n = std::min(ReduceSamples, numSamples - j);
+			const int64_t k = (int64_t)i * numSamples + j;
+			const int32_t run = next.tiled ? job.tiling.contiguous(k) : 0;
+			if (run > 0)
+				n = std::min(n, run);
+
+			evaluateBlock(next.t, next.storage, job.table, i, j, channelPhases(i), groupPhases,
+				next.groupEdge, next.lod, channelEdges, Span<float>(job.values + k, n));
+			j += n;
+		}
+	}
+	chop->mySpeculationComplete = true;
+}
+
+double
+PhaserCHOP::advanceClock(const OP_Inputs* inputs)
+{
+	// Duration can't be zero. We'll rely on the Parameter settings to prevent this.
+	const double duration = std::max(smallestDouble, inputs->getParDouble("Duration"));
+	const OP_TimeInfo* timeInfo = inputs->getTimeInfo();
+
+	// deltaFrames counts dropped frames too, so the clock doesn't drift.
+	if (myClockReset)
+	{
+		myClockReset = false;
+	}
+	else if (timeInfo && timeInfo->rate > 0.)
+	{
+		myClock += timeInfo->deltaFrames / timeInfo->rate / duration;
+	}
+
+	switch ((PHASER_ClockMode)inputs->getParInt("Clockmode"))
+	{
+		case PHASER_ClockMode::Pingpong:
+			myClock = fmod(myClock, 2.);
+			return myClock <= 1. ? myClock : 2. - myClock;
+		case PHASER_ClockMode::Once:
+			myClock = std::min(myClock, 1.);
+			return myClock;
+		default:
+			myClock = fmod(myClock, 1.);
+			return myClock;
+	}
+}
+
+int32_t
+PhaserCHOP::updateClocks(const OP_Inputs* inputs, double clockT, double edge, bool staged, int32_t numChannels)
+{
+	PHASER_TRACE_SCOPE("updateClocks");
+
+	const OP_CHOPInput* timeInput = inputs->getInputCHOP(0);
+	const bool wired = timeInput && timeInput->numChannels > 0 && timeInput->numSamples > 0;
+
+	PHASER_PctMode mode = wired ? (PHASER_PctMode)inputs->getParInt("Pctmode") : PHASER_PctMode::Shared;
+	if (mode != PHASER_PctMode::Perchannel && mode != PHASER_PctMode::Group)
+	{
+		mode = PHASER_PctMode::Shared;
+	}
+
+	// The group id channel only picks clocks, the other pct channels are the clocks.
+	const int32_t groupChannel = mode == PHASER_PctMode::Group ?
+		findChannel(timeInput, inputs->getParString("Groupchannel")) : -1;
+	if (mode == PHASER_PctMode::Group && groupChannel < 0)
+	{
+		mode = PHASER_PctMode::Perchannel;
+	}
+
+	const int32_t numClocks = mode == PHASER_PctMode::Shared ? 1 : std::max(numChannels, 1);
+	PhaserStages::Active* clocks = myArena.get<PhaserStages::Active>(PHASER_BlockClocks, numClocks);
+
+	for (int32_t c = 0; c < numClocks; c++)
+	{
+		int32_t source = 0;
+		if (mode == PHASER_PctMode::Perchannel)
+		{
+			source = std::min(c, timeInput->numChannels - 1);
+		}
+		else if (mode == PHASER_PctMode::Group)
+		{
+			// Group ids count the pct channels other than the group id channel.
+			const float* ids = timeInput->getChannelData(groupChannel);
+			const int32_t numGroups = timeInput->numChannels - 1;
+			const int32_t id = (int32_t)std::lround(clamp(ids[std::min(c, timeInput->numSamples - 1)], 0., (double)std::max(numGroups - 1, 0)));
+			source = numGroups > 0 ? (id < groupChannel ? id : id + 1) : -1;
+		}
+
+		// Get the latest sample in the time input because PhaserCHOP doesn't
+		// yet support timeslicing.
+		double t = clockT;
+		if (wired && source >= 0)
+		{
+			t = clamp(timeInput->getChannelData(source)[timeInput->numSamples - 1], 0., 1.);
+		}
+
+		clocks[c] = staged ? myStages.evaluate(t, edge) : PhaserStages::Active{ t, edge, 0.f, 1.f, 1.f };
+		clocks[c].edge = std::max(smallestDouble, clocks[c].edge);
+	}
+
+	myClocks = clocks;
+	return numClocks;
+}
+
+void
+PhaserCHOP::updateEvents(int32_t numClocks, const float* startTimes, const float* endTimes,
+	int32_t numChannels, int32_t numSamples, bool timesChanged)
+{
+	PHASER_TRACE_SCOPE("updateEvents");
+
+	const int32_t numValues = numChannels * numSamples;
+	// The values each clock drives are sorted together.
+	const int32_t segmentSamples = numClocks > 1 ? numSamples : numValues;
+
+	int32_t* startOrder = myArena.get<int32_t>(PHASER_BlockStartOrder, numValues);
+	int32_t* endOrder = myArena.get<int32_t>(PHASER_BlockEndOrder, numValues);
+	double* previousT = myArena.get<double>(PHASER_BlockEventClocks, numClocks);
+	int32_t* events = myArena.get<int32_t>(PHASER_BlockEvents, numValues);
+	float* eventValues = myArena.get<float>(PHASER_BlockEventValues, numValues);
+
+	if (!myOrderValid || timesChanged || myNumEventClocks != numClocks)
+	{
+		for (int32_t i = 0; i < numValues; i++)
+		{
+			startOrder[i] = i;
+			endOrder[i] = i;
+		}
+		for (int32_t first = 0; segmentSamples > 0 && first < numValues; first += segmentSamples)
+		{
+			std::sort(startOrder + first, startOrder + first + segmentSamples,
+				[startTimes](int32_t a, int32_t b) { return startTimes[a] < startTimes[b]; });
+			std::sort(endOrder + first, endOrder + first + segmentSamples,
+				[endTimes](int32_t a, int32_t b) { return endTimes[a] < endTimes[b]; });
+		}
+		myOrderValid = true;
+	}
+
+	// No events on the first cook.
+	const bool first = myNumEventClocks != numClocks;
+	myNumEventClocks = numClocks;
+
+	for (int32_t c = 0; c < numClocks; c++)
+	{
+		const double t = myClocks[c].t;
+		const double eventT = previousT[c];
+		previousT[c] = t;
+		if (first || t == eventT)
+			continue;
+
+		int32_t* begin;
+		int32_t* end;
+		float value;
+		if (t > eventT)
+		{
+			// Values whose end time was passed reached 1.
+			int32_t* segment = endOrder + (size_t)c * segmentSamples;
+			auto endBefore = [endTimes](double time, int32_t i) { return time < endTimes[i]; };
+			begin = std::upper_bound(segment, segment + segmentSamples, eventT, endBefore);
+			end = std::upper_bound(begin, segment + segmentSamples, t, endBefore);
+			value = 1.f;
+		}
+		else
+		{
+			// Going back, values whose start time was passed reached 0.
+			int32_t* segment = startOrder + (size_t)c * segmentSamples;
+			auto startBefore = [startTimes](int32_t i, double time) { return startTimes[i] < time; };
+			begin = std::lower_bound(segment, segment + segmentSamples, t, startBefore);
+			end = std::lower_bound(begin, segment + segmentSamples, eventT, startBefore);
+			value = 0.f;
+		}
+
+		for (int32_t* e = begin; e != end; e++)
+		{
+			events[myNumEvents] = *e;
+			eventValues[myNumEvents] = value;
+			myNumEvents++;
+		}
+	}
+}
+
+bool
+PhaserCHOP::updateContentHash(const OP_CHOPInput* input, PHASER_ContentHash& state)
+{
+	if (!input)
+	{
+		bool changed = state.totalCooks != -1;
+		state.reset();
+		return changed;
+	}
+
+	if (input->opId == state.opId && input->totalCooks == state.totalCooks &&
+		input->numChannels == state.numChannels && input->numSamples == state.numSamples)
+	{
+		state.numDirtyChunks = 0;
+		return false;
+	}
+
+	const uint32_t previousOpId = state.opId;
+	bool changed = hashContent(input->channelData, input->numChannels, input->numSamples, state);
+
+	// Same source, same data, new cook.
+	if (!changed && input->opId == previousOpId)
+	{
+		mySpuriousRecooks++;
+	}
+
+	state.opId = input->opId;
+	state.totalCooks = input->totalCooks;
+	return changed;
+}
+
+bool
+PhaserCHOP::hashContent(const float* const* channels, int32_t numChannels, int32_t numSamples, PHASER_ContentHash& state)
+{
+	PHASER_TRACE_SCOPE("hashContent");
+
+	auto hashStart = std::chrono::steady_clock::now();
+
+	const int32_t chunkSamples = PhaserPhaseTable::ChunkSamples;
+	const int32_t numChunks = numChannels * ((numSamples + chunkSamples - 1) / chunkSamples);
+	const bool sameSize = numChannels == state.numChannels && numSamples == state.numSamples;
+
+	// The chunk hashes of the last rehash stay in their block as long as the
+	// size doesn't change, which is the only time they are compared.
+	uint64_t* chunkHashes = myArena.get<uint64_t>(state.hashBlock, numChunks);
+	uint64_t* newHashes = myArena.get<uint64_t>(PHASER_BlockNewChunkHashes, numChunks);
+	int32_t* dirtyChunks = myArena.get<int32_t>(state.dirtyBlock, numChunks);
+
+	uint64_t hash = PhaserHash::hashChunks(channels, numChannels, numSamples, chunkSamples, newHashes);
+
+	int32_t numDirty = 0;
+	for (int32_t chunk = 0; chunk < numChunks; chunk++)
+	{
+		if (!sameSize || newHashes[chunk] != chunkHashes[chunk])
+		{
+			dirtyChunks[numDirty++] = chunk;
+		}
+		chunkHashes[chunk] = newHashes[chunk];
+	}
+
+	bool changed = !sameSize || hash != state.hash;
+
+	state.numChannels = numChannels;
+	state.numSamples = numSamples;
+	state.hash = hash;
+	state.dirtyChunks = dirtyChunks;
+	state.numDirtyChunks = numDirty;
+
+	std::chrono::duration<double, std::milli> hashTime = std::chrono::steady_clock::now() - hashStart;
+	myInfoValues[PHASER_InfoHashMs] += (float)hashTime.count();
+	return changed;
+}
+
+void
+PhaserCHOP::rebuildRanks(void* self)
+{
+	PHASER_TRACE_SCOPE("rank rebuild");
+
+	PhaserCHOP* chop = static_cast<PhaserCHOP*>(self);
+	PHASER_RankJob& job = chop->myRankJob;
+	auto sortStart = std::chrono::steady_clock::now();
+	job.table = PhaserPhaseTable::acquireRanks(job.key, job.channels, job.order, job.bits, job.bitsScratch, job.orderScratch);
+	job.sortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sortStart).count();
+}
+
+void
+PhaserCHOP::updateRankPhases(const OP_CHOPInput* phaseInput, PHASER_Rebuild rebuild)
+{
+	PHASER_TRACE_SCOPE("updateRankPhases");
+
+	const int32_t numChannels = phaseInput->numChannels;
+	const int32_t numSamples = phaseInput->numSamples;
+	const size_t numValues = (size_t)numChannels * numSamples;
+
+	PhaserPhaseTable::Key key;
+	key.contentHash = myPhaseHash.hash;
+	key.numChannels = numChannels;
+	key.numSamples = numSamples;
+	key.storage = PHASER_PhaseStorage::Float32;
+	key.ranked = true;
+
+	// Deferred rebuilds keep serving the current ranks while the new ones are
+	// sorted, as long as they have the right size. Otherwise the cook waits.
+	const bool sameSize = myRankTable &&
+		myRankTable->key().numChannels == numChannels && myRankTable->key().numSamples == numSamples;
+	const bool serveFront = rebuild == PHASER_Rebuild::Deferred && sameSize;
+	if (myRankWorker.pending() && (myRankWorker.done() || !serveFront))
+	{
+		myRankWorker.collect();
+		myRankTable = std::move(myRankJob.table);
+		myInfoValues[PHASER_InfoRankSortMs] = (float)myRankJob.sortMs;
+	}
+
+	const bool stale = !myRankTable || myRankTable->key().contentHash != key.contentHash || !sameSize;
+
+	// The blocks a running rebuild reads can't be touched until it is done.
+	// Otherwise the sort scratch is only requested when no node holds the
+	// ranks of these keys, so Trim Memory can give it back afterwards.
+	if (!myRankWorker.pending())
+	{
+		std::shared_ptr<const PhaserPhaseTable> shared = stale ? PhaserPhaseTable::find(key) : nullptr;
+		const bool sort = stale && !shared;
+		const bool background = sort && serveFront;
+
+		const int32_t sortSamples = sort ? numSamples : 0;
+		int32_t* order = myArena.get<int32_t>(PHASER_BlockSortOrder, sortSamples);
+		int32_t* orderScratch = myArena.get<int32_t>(PHASER_BlockSortOrderScratch, sortSamples);
+		uint32_t* bits = myArena.get<uint32_t>(PHASER_BlockSortBits, sortSamples);
+		uint32_t* bitsScratch = myArena.get<uint32_t>(PHASER_BlockSortBitsScratch, sortSamples);
+		float* keys = myArena.get<float>(PHASER_BlockRankKeys, background ? numValues : 0);
+		const float** keyChannels = myArena.get<const float*>(PHASER_BlockRankKeyChannels, background ? numChannels : 0);
+
+		if (shared)
+		{
+			myRankTable = std::move(shared);
+		}
+		else if (background)
+		{
+			// The input is only readable during the cook, so the job sorts a copy.
+			for (int32_t i = 0; i < numChannels; i++)
+			{
+				keyChannels[i] = keys + (size_t)i * numSamples;
+				memcpy(keys + (size_t)i * numSamples, phaseInput->getChannelData(i), numSamples * sizeof(float));
+			}
+
+			myRankJob.key = key;
+			myRankJob.channels = keyChannels;
+			myRankJob.order = order;
+			myRankJob.bits = bits;
+			myRankJob.bitsScratch = bitsScratch;
+			myRankJob.orderScratch = orderScratch;
+			myRankWorker.start(rebuildRanks, this);
+		}
+		else if (sort)
+		{
+			auto sortStart = std::chrono::steady_clock::now();
+			myRankTable = PhaserPhaseTable::acquireRanks(key, phaseInput->channelData, order, bits, bitsScratch, orderScratch);
+			std::chrono::duration<double, std::milli> sortTime = std::chrono::steady_clock::now() - sortStart;
+			myInfoValues[PHASER_InfoRankSortMs] = (float)sortTime.count();
+		}
+	}
+
+	const float** channels = myArena.get<const float*>(PHASER_BlockRankChannels, numChannels);
+	for (int32_t i = 0; i < numChannels; i++)
+	{
+		channels[i] = myRankTable->ranks(i);
+	}
+}
+
+void
+PhaserCHOP::updatePhaseTable(const OP_CHOPInput* phaseInput, int32_t numChannels, int32_t numSamples, PHASER_PhaseStorage storage,
+	bool rank, PHASER_Rebuild rebuild)
+{
+	PHASER_TRACE_SCOPE("updatePhaseTable");
+
+	// Rely on the N samples parameter and make a descending ramp of phase samples.
+	myRampPhases = myArena.get<float>(PHASER_BlockRampPhases, phaseInput ? 0 : numSamples);
+	// The dirty chunks are those that changed since this hash, so only a table
+	// made from the phases themselves, not from their ranks, can be patched.
+	const uint64_t previousHash = myPhaseHash.hash;
+
+	if (phaseInput)
+	{
+		myRampSamples = -1;
+		updateContentHash(phaseInput, myPhaseHash);
+	}
+	else if (myRampSamples != numSamples)
+	{
+		myRampSamples = numSamples;
+		for (int32_t j = 0; j < numSamples; j++)
+		{
+			// Question: what if the ramp is only 1 sample? Then pick 0.5 rather than 0 or 1.
+			myRampPhases[j] = numSamples > 1 ? 1. - (double)j / (double)(numSamples - 1) : 0.5;
+		}
+
+		myPhaseHash.opId = 0;
+		myPhaseHash.totalCooks = -1;
+		hashContent(&myRampPhases, 1, numSamples, myPhaseHash);
+	}
+	else
+	{
+		myPhaseHash.numDirtyChunks = 0;
+	}
+
+	myInfoValues[PHASER_InfoDirtyChunks] = (float)myPhaseHash.numDirtyChunks;
+
+	rank = rank && phaseInput;
+	if (rank)
+	{
+		updateRankPhases(phaseInput, rebuild);
+	}
+	else
+	{
+		myRankWorker.collect();
+		myRankJob.table.reset();
+		myRankTable.reset();
+		myArena.get<const float*>(PHASER_BlockRankChannels, 0);
+	}
+
+	// The ranks being served lag behind the phase input during a deferred
+	// rebuild, so tables made from them are keyed by the keys they were
+	// sorted from. Ranks also get their own hash, so that times made from
+	// the phase input itself are not mistaken for them.
+	const uint64_t sourceHash = rank ? myRankTable->key().contentHash : myPhaseHash.hash;
+	myPhasesHash = rank ? PhaserHash::hash(&sourceHash, sizeof(sourceHash), RankHashSeed) : sourceHash;
+	myPhaseChannels = rank ? myArena.get<const float*>(PHASER_BlockRankChannels, numChannels) :
+		phaseInput ? phaseInput->channelData : &myRampPhases;
+
+	if (storage == PHASER_PhaseStorage::Float32)
+	{
+		myPhaseTable.reset();
+		return;
+	}
+
+	if (myPhaseTable)
+	{
+		const PhaserPhaseTable::Key& current = myPhaseTable->key();
+		if (current.contentHash == sourceHash && current.ranked == rank &&
+			current.numChannels == numChannels && current.numSamples == numSamples &&
+			current.storage == storage)
+		{
+			return;
+		}
+	}
+
+	PhaserPhaseTable::Key key;
+	key.contentHash = sourceHash;
+	key.numChannels = numChannels;
+	key.numSamples = numSamples;
+	key.storage = storage;
+	key.ranked = rank;
+
+	auto buildStart = std::chrono::steady_clock::now();
+
+	const float* const* channels = myPhaseChannels;
+	if (myPhaseTable && myPhaseTable->key().contentHash == previousHash && !myPhaseTable->key().ranked && !rank)
+	{
+		// Hand our reference over, so the table can be patched in place
+		// if no other node uses it.
+		myPhaseTable = PhaserPhaseTable::acquire(key, channels, std::move(myPhaseTable),
+			myPhaseHash.dirtyChunks, myPhaseHash.numDirtyChunks);
+	}
+	else
+	{
+		// Release our old table first so that the cache can drop it.
+		myPhaseTable.reset();
+		myPhaseTable = PhaserPhaseTable::acquire(key, channels);
+	}
+
+	std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - buildStart;
+	myInfoValues[PHASER_InfoTableBuildMs] = (float)buildTime.count();
+}
+
+int32_t
+PhaserCHOP::getNumInfoCHOPChans(void* reserved1)
+{
+	return PHASER_NumInfoChans;
+}
+
+void
+PhaserCHOP::getInfoCHOPChan(int32_t index,
+	OP_InfoCHOPChan* chan,
+	void* reserved1)
+{
+	static const char* names[PHASER_NumInfoChans] =
+	{
+		"kernel_ms",
+		"phase_bytes_per_sample",
+		"phase_bytes_saved",
+		"phase_max_error",
+		"output_max_error",
+		"arena_bytes",
+		"arena_grows",
+		"phase_table_bytes",
+		"phase_table_users",
+		"hash_ms",
+		"spurious_recooks",
+		"dirty_chunks",
+		"table_build_ms",
+		"finished",
+		"moving",
+		"events",
+		"changed",
+		"rank_sort_ms",
+		"name_build_ms",
+		"lod",
+		"rebuild_pending",
+		"speculation_hits",
+		"speculation_hit_rate",
+	};
+
+	chan->name->setString(names[index]);
+	chan->value = myInfoValues[index];
+}
+
+bool		
+PhaserCHOP::getInfoDATSize(OP_InfoDATSize* infoSize, void* reserved1)
+{
+	if (myInfoDAT == PHASER_InfoDAT::Events)
+	{
+		// index and value of every value that reached 0 or 1, plus a header row.
+		infoSize->rows = 1 + myNumEvents;
+		infoSize->cols = 2;
+	}
+	else if (myInfoDAT == PHASER_InfoDAT::Changes)
+	{
+		// index and new value of every value that changed, plus a header row.
+		infoSize->rows = 1 + myNumChanged;
+		infoSize->cols = 2;
+	}
+	else
+	{
+		// The verification report, plus a header row, once Verify has been pulsed.
+		infoSize->rows = myVerifyReport.empty() ? 0 : 1 + (int32_t)myVerifyReport.size();
+		infoSize->cols = myVerifyReport.empty() ? 0 : 6;
+	}
+	// Setting this to false means we'll be assigning values to the table
+	// one row at a time. True means we'll do it one column at a time.
+	infoSize->byColumn = false;
+	return true;
+}
+
+void
+PhaserCHOP::getInfoDATEntries(int32_t index,
+	int32_t nEntries,
+	OP_InfoDATEntries* entries,
+	void* reserved1)
+{
+	if (myInfoDAT == PHASER_InfoDAT::Events)
+	{
+		if (index == 0)
+		{
+			entries->values[0]->setString("index");
+			entries->values[1]->setString("value");
+			return;
+		}
+
+		// Looked up again, since Trim Memory may have moved the blocks.
+		const int32_t* events = myArena.data<int32_t>(PHASER_BlockEvents);
+		const float* eventValues = myArena.data<float>(PHASER_BlockEventValues);
+
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "%d", events[index - 1]);
+		entries->values[0]->setString(buffer);
+		entries->values[1]->setString(eventValues[index - 1] == 1.f ? "1" : "0");
+		return;
+	}
+
+	if (myInfoDAT == PHASER_InfoDAT::Changes)
+	{
+		if (index == 0)
+		{
+			entries->values[0]->setString("index");
+			entries->values[1]->setString("value");
+			return;
+		}
+
+		const int32_t* changedIndices = myArena.data<int32_t>(PHASER_BlockChangedIndices);
+		const float* changedValues = myArena.data<float>(PHASER_BlockChangedValues);
+
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), "%d", changedIndices[index - 1]);
+		entries->values[0]->setString(buffer);
+		snprintf(buffer, sizeof(buffer), "%.9g", changedValues[index - 1]);
+		entries->values[1]->setString(buffer);
+		return;
+	}
+
+	if (index == 0)
+	{
+		const char* header[] = { "variant", "samples", "max_abs_error", "max_ulp_error", "nan_mismatches", "status" };
+		for (int32_t i = 0; i < nEntries; i++)
+			entries->values[i]->setString(header[i]);
+		return;
+	}
+
+	const VerifyResult& result = myVerifyReport[index - 1];
+	char buffer[64];
+
+	entries->values[0]->setString(result.variant);
+	snprintf(buffer, sizeof(buffer), "%lld", (long long)result.numSamples);
+	entries->values[1]->setString(buffer);
+	snprintf(buffer, sizeof(buffer), "%g", result.maxAbsError);
+	entries->values[2]->setString(buffer);
+	snprintf(buffer, sizeof(buffer), "%lld", (long long)result.maxUlpError);
+	entries->values[3]->setString(buffer);
+	snprintf(buffer, sizeof(buffer), "%lld", (long long)result.nanMismatches);
+	entries->values[4]->setString(buffer);
+	entries->values[5]->setString(result.passed ? "pass" : "FAIL");
+}
+
+void
+PhaserCHOP::getWarningString(OP_String* warning, void* reserved1)
+{
+	for (const VerifyResult& result : myVerifyReport)
+	{
+		if (!result.passed)
+		{
+			warning->setString("Kernel verification failed, see the Info DAT");
+			return;
+		}
+	}
+
+#ifdef PHASER_TRACE
+	if (myTraceFailed)
+	{
+		warning->setString("Couldn't write the trace file");
+	}
+#endif
+}
+
+void
+PhaserCHOP::setupParameters(OP_ParameterManager* manager, void* reserved1)
+{
+	// Edge
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Edge";
+		np.label = "Edge";
+		np.defaultValues[0] = 1.0;
+		np.minSliders[0] = smallestDouble;
+		np.maxSliders[0] =  10.0;
+
+		np.clampMins[0] = true;
+		np.minValues[0] = smallestDouble;
+		
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Number of samples:
+	// This parameter only matters when phase samples isn't wired in.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Nsamples";
+		np.label = "N Samples";
+		np.defaultValues[0] = 10.0;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 10.;
+
+		np.clampMins[0] = true;
+		np.minValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Output Format:
+	// First option is do nothing and copy info of phase samples input.
+	// Second option is equivalent to shuffle chop swap channels and samples.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Outputformat";
+		sp.label = "Output Format";
+
+		sp.defaultValue = "Onechannel";
+
+		const char* names[] = { "Onechannel", "Multichannels", "Tiled" };
+		const char* labels[] = { "One Channel", "Multi-Channels", "Tiled" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 3, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Tile Width / Tile Height:
+	// The channels and samples of the Tiled format. 0 works the size out
+	// from the other one and the number of values.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Tilewidth";
+		np.label = "Tile Width";
+		np.defaultValues[0] = 1;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 1024;
+
+		np.clampMins[0] = true;
+		np.minValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Tileheight";
+		np.label = "Tile Height";
+		np.defaultValues[0] = 0;
+		np.minSliders[0] = 0;
+		np.maxSliders[0] = 1024;
+
+		np.clampMins[0] = true;
+		np.minValues[0] = 0;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Tile Order:
+	// Row Major fills one output channel after the other, Column Major
+	// fills the first sample of every channel, then the second...
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Tileorder";
+		sp.label = "Tile Order";
+
+		sp.defaultValue = "Rowmajor";
+
+		const char* names[] = { "Rowmajor", "Columnmajor" };
+		const char* labels[] = { "Row Major", "Column Major" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 2, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Serpentine:
+	// Reverses every other row, for LED strips wired back and forth.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Serpentine";
+		np.label = "Serpentine";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Channel Names:
+	// How the channels of the Multichannels and Tiled formats are named: a
+	// prefix followed by the channel number, or the first column of a DAT.
+	// Tiled names its Tile Width channels, and repeats the names per group.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Channelnames";
+		sp.label = "Channel Names";
+
+		sp.defaultValue = "Index";
+
+		const char* names[] = { "Index", "DAT" };
+		const char* labels[] = { "Prefix + Index", "Name DAT" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 2, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Nameprefix";
+		sp.label = "Name Prefix";
+
+		sp.defaultValue = "chan";
+
+		OP_ParAppendResult res = manager->appendString(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Rows past the end of the DAT, or with an empty first cell, fall back
+	// to the prefix and number.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Namedat";
+		sp.label = "Name DAT";
+
+		OP_ParAppendResult res = manager->appendDAT(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Phase Storage:
+	// Float32 reads the phase input as is. The 16-bit options keep a compact copy
+	// of the phases that is rebuilt only when the phase input cooks, which halves
+	// the memory traffic of the kernel for very large phase inputs.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Phasestorage";
+		sp.label = "Phase Storage";
+
+		sp.defaultValue = "Float32";
+
+		const char* names[] = { "Float32", "Unorm16", "Half16" };
+		const char* labels[] = { "Float 32-bit", "Unorm 16-bit", "Half Float 16-bit" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 3, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Rank Phases:
+	// Uses the rank of each sample of a phase channel as its phase, from 0
+	// for the smallest to 1 for the largest. The phase input then only has
+	// to hold sortable keys, like distances or random values. The ranks are
+	// sorted again only when the content of the phase input changes.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Rankphase";
+		np.label = "Rank Phases";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Pct Mode:
+	// Shared drives every phase channel with the first pct channel. Per Channel
+	// drives phase channel c with pct channel c, reusing the last one. Group ID
+	// reads the pct channel of each phase channel from a group id channel.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Pctmode";
+		sp.label = "Pct Mode";
+
+		sp.defaultValue = "Shared";
+
+		const char* names[] = { "Shared", "Perchannel", "Group" };
+		const char* labels[] = { "Shared", "Per Channel", "Group ID" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 3, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Group ID Channel:
+	// The pct channel whose sample c is the group id of phase channel c.
+	// Group id g is the g-th of the other pct channels.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Groupchannel";
+		sp.label = "Group ID Channel";
+
+		sp.defaultValue = "group";
+
+		OP_ParAppendResult res = manager->appendString(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Hierarchical:
+	// Staggers groups of samples by the phases of the Group Phase channel,
+	// then the members of each group by the phases of the other channels.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Hierarchical";
+		np.label = "Hierarchical";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Group Phase Channel:
+	// The phase channel holding the group phase of each sample.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Groupphase";
+		sp.label = "Group Phase Channel";
+
+		sp.defaultValue = "group";
+
+		OP_ParAppendResult res = manager->appendString(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Group Edge:
+	// The edge between the groups. Edge is then the edge between the
+	// members of a group.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Groupedge";
+		np.label = "Group Edge";
+		np.defaultValues[0] = 1.0;
+		np.minSliders[0] = smallestDouble;
+		np.maxSliders[0] = 10.0;
+
+		np.clampMins[0] = true;
+		np.minValues[0] = smallestDouble;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Rebuild:
+	// Block sorts new rank phases in the cook that needs them. Deferred sorts
+	// them on a background thread and keeps using the previous ranks until
+	// they are ready, usually one frame later.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Rebuild";
+		sp.label = "Rebuild";
+
+		sp.defaultValue = "Block";
+
+		const char* names[] = { "Block", "Deferred" };
+		const char* labels[] = { "Block on First Use", "Serve Previous Tables" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 2, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Stage DAT:
+	// A table of stages (start, end, edge, from, to) that turns the phaser
+	// into a keyframed one. See PhaserStages.h.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Stagedat";
+		sp.label = "Stage DAT";
+
+		OP_ParAppendResult res = manager->appendDAT(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Output Start/End Times:
+	// Adds channels with the t at which each sample starts moving (_tstart)
+	// and at which it reaches 1 (_tend).
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Timechannels";
+		np.label = "Output Start/End Times";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Output Velocities:
+	// Adds channels with d(phaser)/dt of each sample (_vel).
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Velocitychannels";
+		np.label = "Output Velocities";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Info DAT:
+	// Verify shows the kernel verification report. Events lists the values
+	// that reached 0 or 1 since the previous cook, Changes lists the values
+	// that changed since the previous cook.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Infodat";
+		sp.label = "Info DAT";
+
+		sp.defaultValue = "Verify";
+
+		const char* names[] = { "Verify", "Events", "Changes" };
+		const char* labels[] = { "Verify Report", "Completion Events", "Changed Values" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 3, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Duration:
+	// Seconds the internal clock takes to go from 0 to 1 when pct isn't wired.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Duration";
+		np.label = "Duration";
+		np.defaultValues[0] = 4.0;
+		np.minSliders[0] = smallestDouble;
+		np.maxSliders[0] = 30.0;
+
+		np.clampMins[0] = true;
+		np.minValues[0] = smallestDouble;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Clock Mode:
+	// What the internal clock does once it reaches 1.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Clockmode";
+		sp.label = "Clock Mode";
+
+		sp.defaultValue = "Loop";
+
+		const char* names[] = { "Loop", "Pingpong", "Once" };
+		const char* labels[] = { "Loop", "Ping-Pong", "Once" };
+
+		OP_ParAppendResult res = manager->appendMenu(sp, 3, names, labels);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Reset Clock:
+	// Moves the internal clock back to 0.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Resetclock";
+		np.label = "Reset Clock";
+
+		OP_ParAppendResult res = manager->appendPulse(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Smart Cook:
+	// Only asks to cook every frame while the internal clock is running.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Smartcook";
+		np.label = "Smart Cook";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// LOD:
+	// Evaluates every n-th sample and fills the samples in between linearly.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Lod";
+		np.label = "LOD";
+		np.defaultValues[0] = 1;
+		np.minSliders[0] = 1;
+		np.maxSliders[0] = 16;
+
+		np.clampMins[0] = true;
+		np.minValues[0] = 1;
+		np.clampMaxes[0] = true;
+		np.maxValues[0] = MaxLod;
+
+		OP_ParAppendResult res = manager->appendInt(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Auto LOD:
+	// Raises the LOD while evaluating the values takes longer than LOD Budget, and
+	// lowers it back to LOD as the headroom returns.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Autolod";
+		np.label = "Auto LOD";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Lodbudget";
+		np.label = "LOD Budget (us)";
+		np.defaultValues[0] = 1000.0;
+		np.minSliders[0] = 0.0;
+		np.maxSliders[0] = 16000.0;
+
+		np.clampMins[0] = true;
+		np.minValues[0] = 0.0;
+
+		OP_ParAppendResult res = manager->appendFloat(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Speculate:
+	// After each cook, computes the next one on a background thread for the
+	// pct it reaches if it keeps its speed. The next cook copies those values
+	// when the prediction holds.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Speculate";
+		np.label = "Speculate";
+
+		OP_ParAppendResult res = manager->appendToggle(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Verify:
+	// Checks every optimized kernel against the reference phaser function.
+	// The report shows up in an Info DAT.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Verify";
+		np.label = "Verify Kernels";
+
+		OP_ParAppendResult res = manager->appendPulse(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	// Trim Memory:
+	// Scratch memory only ever grows to the largest size it was needed at.
+	// This gives back whatever the current settings don't use.
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Trimmemory";
+		np.label = "Trim Memory";
+
+		OP_ParAppendResult res = manager->appendPulse(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+#ifdef PHASER_TRACE
+	// Trace File:
+	// Where Write Trace saves the spans recorded so far, as a Chrome trace.
+	{
+		OP_StringParameter	sp;
+
+		sp.name = "Tracefile";
+		sp.label = "Trace File";
+		sp.defaultValue = "phaser_trace.json";
+
+		OP_ParAppendResult res = manager->appendFile(sp);
+		assert(res == OP_ParAppendResult::Success);
+	}
+
+	{
+		OP_NumericParameter	np;
+
+		np.name = "Writetrace";
+		np.label = "Write Trace";
+
+		OP_ParAppendResult res = manager->appendPulse(np);
+		assert(res == OP_ParAppendResult::Success);
+	}
+#endif
+}
+
+void 
+PhaserCHOP::pulsePressed(const char* name, void* reserved1)
+{
+	if (!strcmp(name, "Verify"))
+	{
+		runVerification();
+	}
+	else if (!strcmp(name, "Trimmemory"))
+	{
+		// Background rebuilds and speculation write into arena blocks.
+		myRankWorker.wait();
+		mySpeculationWorker.wait();
+		myArena.trim();
+	}
+	else if (!strcmp(name, "Resetclock"))
+	{
+		myClock = 0.;
+		myClockReset = true;
+	}
+#ifdef PHASER_TRACE
+	else if (!strcmp(name, "Writetrace"))
+	{
+		myTraceFailed = myTraceFile.empty() || !PhaserTrace::write(myTraceFile.c_str());
+	}
+#endif
 }
 
@@ -9,7 +9,17 @@
  */
 
 #include "CHOP_CPlusPlusBase.h"
+#include "PhaserArena.h"
+#include "PhaserChannelNames.h"
+#include "PhaserPhaseTable.h"
+#include "PhaserHash.h"
+#include "PhaserKernels.h"
+#include "PhaserStages.h"
+#include "PhaserWorker.h"
 #include <limits>
+#include <string>
+#include <vector>
+#include <string.h>
  /*
 
  This example file implements a class that does 2 different things depending on
@@ -26,6 +36,234 @@
  */
 
 
+// Info CHOP channels, see PhaserCHOP::getInfoCHOPChan for their names.
+enum PHASER_InfoChan
+{
+	PHASER_InfoKernelMs,
+	PHASER_InfoPhaseBytesPerSample,
+	PHASER_InfoPhaseBytesSaved,
+	PHASER_InfoPhaseMaxError,
+	PHASER_InfoOutputMaxError,
+	PHASER_InfoArenaBytes,
+	PHASER_InfoArenaGrows,
+	PHASER_InfoPhaseTableBytes,
+	PHASER_InfoPhaseTableUsers,
+	PHASER_InfoHashMs,
+	PHASER_InfoSpuriousRecooks,
+	PHASER_InfoDirtyChunks,
+	PHASER_InfoTableBuildMs,
+	PHASER_InfoFinished,
+	PHASER_InfoMoving,
+	PHASER_InfoEvents,
+	PHASER_InfoChanged,
+	PHASER_InfoRankSortMs,
+	PHASER_InfoNameBuildMs,
+	PHASER_InfoLod,
+	PHASER_InfoRebuildPending,
+	PHASER_InfoSpeculationHits,
+	PHASER_InfoSpeculationHitRate,
+	PHASER_NumInfoChans
+};
+
+// How the phaser values are laid out over the output channels.
+enum class PHASER_OutputFormat
+{
+	Invalid = -1,
+	Onechannel,
+	Multichannels,
+	Tiled
+};
+
+// How the internal clock behaves once it reaches the end of its Duration.
+enum class PHASER_ClockMode
+{
+	Invalid = -1,
+	Loop,
+	Pingpong,
+	Once
+};
+
+// Which pct drives each phase channel.
+enum class PHASER_PctMode
+{
+	Invalid = -1,
+	Shared,		// the first pct channel drives every phase channel
+	Perchannel,	// pct channel c drives phase channel c
+	Group		// a group id channel picks the pct channel of each phase channel
+};
+
+// When derived tables that take a while to rebuild are brought up to date.
+enum class PHASER_Rebuild
+{
+	Invalid = -1,
+	Block,		// in the cook that needs them
+	Deferred	// in the background, serving the previous tables meanwhile
+};
+
+// What the Info DAT shows.
+enum class PHASER_InfoDAT
+{
+	Invalid = -1,
+	Verify,
+	Events,
+	Changes
+};
+
+// Identifies the content of an input. The hash is only recomputed when the
+// input has cooked, and stays the same if the cook produced the same data.
+// The input is also hashed in chunks of PhaserPhaseTable::ChunkSamples
+// samples, so that the chunks that changed are known.
+struct PHASER_ContentHash
+{
+	PHASER_ContentHash(int32_t hashes, int32_t dirty) : hashBlock(hashes), dirtyBlock(dirty)
+	{
+	}
+
+	void
+	reset()
+	{
+		opId = 0;
+		totalCooks = -1;
+		numChannels = 0;
+		numSamples = 0;
+		hash = 0;
+		numDirtyChunks = 0;
+	}
+
+	uint32_t	opId = 0;
+	int64_t		totalCooks = -1;
+	int32_t		numChannels = 0;
+	int32_t		numSamples = 0;
+	uint64_t	hash = 0;
+
+	// Arena blocks holding the chunk hashes and the dirty chunk list
+	int32_t		hashBlock;
+	int32_t		dirtyBlock;
+
+	// Chunks that changed in the last rehash
+	const int32_t* dirtyChunks = nullptr;
+	int32_t		numDirtyChunks = 0;
+};
+
+// Blocks of PhaserCHOP::myArena
+enum PHASER_ArenaBlock
+{
+	PHASER_BlockRow,
+	PHASER_BlockVelocityRow,
+	PHASER_BlockEdgeRow,
+	PHASER_BlockRampPhases,
+	PHASER_BlockPhaseChunkHashes,
+	PHASER_BlockPhaseDirtyChunks,
+	PHASER_BlockEdgeChunkHashes,
+	PHASER_BlockEdgeDirtyChunks,
+	PHASER_BlockNewChunkHashes,
+	PHASER_BlockStartTimes,
+	PHASER_BlockEndTimes,
+	PHASER_BlockStartOrder,
+	PHASER_BlockEndOrder,
+	PHASER_BlockPreviousValues,
+	PHASER_BlockChangedIndices,
+	PHASER_BlockChangedValues,
+	PHASER_BlockRankKeys,
+	PHASER_BlockRankKeyChannels,
+	PHASER_BlockRankChannels,
+	PHASER_BlockSortBits,
+	PHASER_BlockSortBitsScratch,
+	PHASER_BlockSortOrder,
+	PHASER_BlockSortOrderScratch,
+	PHASER_BlockClocks,
+	PHASER_BlockTimesEdges,
+	PHASER_BlockEventClocks,
+	PHASER_BlockEvents,
+	PHASER_BlockEventValues,
+	PHASER_BlockSpeculationValues,
+	PHASER_BlockSpeculationPhases,
+	PHASER_NumArenaBlocks
+};
+
+// The Tiled output lays the values out as 'width' channels of 'height'
+// samples, in the order of the phase input (channel after channel). Row major
+// fills one output channel after the other, column major one sample index
+// after the other. Serpentine reverses every other channel (or sample index).
+// Each output group takes 'width' channels of its own. Values that don't fit
+// are dropped, and unused samples are 0.
+struct PHASER_Tiling
+{
+	PHASER_Tiling() = default;
+	PHASER_Tiling(const OP_Inputs* inputs, int64_t numValues);
+
+	// How many values from value k land next to each other in one channel,
+	// or 0 if they don't.
+	int32_t		contiguous(int64_t k) const;
+
+	// True if the run of values from value k is stored backwards.
+	bool		reversed(int64_t k) const;
+
+	// Where the n values from value k start in 'group', when contiguous(k) >= n.
+	float*		address(int64_t k, int32_t n, float* const* channels, int32_t group) const;
+
+	// Writes 'values', which are the values from value k on, to 'group'.
+	void		store(PhaserKernels::Span<const float> values, int64_t k, float* const* channels, int32_t group) const;
+
+	// Zeroes the samples of 'group' that no value lands on.
+	void		clear(int64_t numValues, float* const* channels, int32_t group) const;
+
+	int32_t		width = 1;
+	int32_t		height = 1;
+	bool		columnMajor = false;
+	bool		serpentine = false;
+};
+
+// What a speculative cook computed its values for. Each cook fills one in
+// to see if the values computed ahead of it can stand in for its own.
+struct PHASER_Speculation
+{
+	// True if the values computed for 'other' are within float precision of these.
+	bool		hits(const PHASER_Speculation& other) const;
+
+	uint64_t	phasesHash = 0;
+	double		t = 0.;
+	double		edge = 0.;
+	double		groupEdge = 0.;
+	PHASER_PhaseStorage storage = PHASER_PhaseStorage::Float32;
+	int32_t		numChannels = 0;
+	int32_t		numSamples = 0;
+	int32_t		groupChannel = -1;
+	int32_t		lod = 1;
+
+	// Tiled output cuts the blocks the LOD kernels interpolate across.
+	bool		tiled = false;
+	int32_t		tileWidth = 0;
+	int32_t		tileHeight = 0;
+	bool		columnMajor = false;
+};
+
+// What a deferred rank rebuild sorts, see PhaserCHOP::updateRankPhases.
+// 'table' receives the ranks, and 'channels' holds a copy of the keys.
+struct PHASER_RankJob
+{
+	PhaserPhaseTable::Key	key;
+	const float* const*	channels = nullptr;
+	int32_t*	order = nullptr;
+	uint32_t*	bits = nullptr;
+	uint32_t*	bitsScratch = nullptr;
+	int32_t*	orderScratch = nullptr;
+	std::shared_ptr<const PhaserPhaseTable>	table;
+	double		sortMs = 0.;
+};
+
+// What the speculative cook evaluates, see PhaserCHOP::startSpeculation.
+// 'copied' holds the phase input, otherwise the phases are read from 'channels'.
+struct PHASER_SpeculationJob
+{
+	PHASER_Speculation	next;
+	const float* const*	channels = nullptr;
+	const float*		copied = nullptr;
+	const PhaserPhaseTable*	table = nullptr;
+	float*				values = nullptr;
+	PHASER_Tiling		tiling;
+};
+
  // To get more help about these functions, look at CHOP_CPlusPlusBase.h
 class PhaserCHOP : public CHOP_CPlusPlusBase
 {
@@ -53,6 +291,8 @@ public:
 		OP_InfoDATEntries* entries,
 		void* reserved1) override;
 
+	virtual void		getWarningString(OP_String* warning, void* reserved1) override;
+
 	virtual void		setupParameters(OP_ParameterManager* manager, void* reserved1) override;
 	virtual void		pulsePressed(const char* name, void* reserved1) override;
 
@@ -63,20 +303,183 @@ private:
 	// this instance of the class (like its name).
 	const OP_NodeInfo*	myNodeInfo;
 
-	float clamp(double a, double theMin, double theMax);
-	float phaser(double t, double phase, double theEdge);
+	static float clamp(double a, double theMin, double theMax);
+	static float phaser(double t, double phase, double theEdge);
+
+	// Advances the internal clock by the time elapsed since the previous cook
+	// and returns its t.
+	double advanceClock(const OP_Inputs* inputs);
+
+	// Appends the values that differ from 'previous' to the change list and
+	// updates 'previous'. 'first' is the index of values[0].
+	void diffValues(const float* values, float* previous, int32_t first, int32_t n);
+
+	// Fills myClocks with the pct, and the stage it falls in, of each of the
+	// returned number of clocks. Phase channel c uses clock min(c, count - 1).
+	int32_t updateClocks(const OP_Inputs* inputs, double clockT, double edge, bool staged, int32_t numChannels);
+
+	// Sorts the start/end times and finds the values that reached 0 or 1
+	// since the pct of the previous cook. With one clock per channel, each
+	// channel is sorted and searched on its own.
+	void updateEvents(int32_t numClocks, const float* startTimes, const float* endTimes,
+		int32_t numChannels, int32_t numSamples, bool timesChanged);
+
+	// Rehashes 'input' if it has cooked since 'state' was filled in.
+	// Returns true if its content changed.
+	bool updateContentHash(const OP_CHOPInput* input, PHASER_ContentHash& state);
+	bool hashContent(const float* const* channels, int32_t numChannels, int32_t numSamples, PHASER_ContentHash& state);
+
+	// Rebuilds the ramp (or rank) phases and picks up the shared 16-bit phase table when their source changes.
+	void updatePhaseTable(const OP_CHOPInput* phaseInput, int32_t numChannels, int32_t numSamples, PHASER_PhaseStorage storage,
+		bool rank, PHASER_Rebuild rebuild);
+
+	// Replaces each phase channel with the rank of its samples, scaled to [0, 1].
+	void updateRankPhases(const OP_CHOPInput* phaseInput, PHASER_Rebuild rebuild);
+
+	// Starts computing the values of the next cook in the background, for
+	// the t that pct reaches if it keeps its speed. 'current' is null when
+	// this cook can't be speculated on.
+	void startSpeculation(const PHASER_Speculation* current, const OP_CHOPInput* phaseInput, bool rank,
+		const PHASER_Tiling& tiling);
+
+	// Worker jobs. 'self' is the PhaserCHOP, which holds their parameters.
+	static void rebuildRanks(void* self);
+	static void speculate(void* self);
+
+	// Runs every kernel variant against PhaserKernels::reference, checks that
+	// toggling Rank Phase rebuilds the phase tables, and fills myVerifyReport.
+	void runVerification();
 
 	char* myError;
 
-	const double smallestDouble = pow(2, -16);
+	static constexpr double smallestDouble = 1. / 65536.; // 2^-16
+
+	// Samples evaluated at a time, so the progress counts see them in cache.
+	static constexpr int32_t ReduceSamples = 4096;
+
+	// Auto LOD never skips more samples than this, and only halves the LOD
+	// when twice the evaluation time is below this fraction of the budget.
+	static constexpr int32_t MaxLod = 64;
+	static constexpr double LodRecovery = 0.8;
+
+	PhaserStages myStages;
+
+	// Channel names of the Multichannels format.
+	PhaserChannelNames myChannelNames;
 
-	double myRamp = 0.;
+	// Position of the internal clock, in Durations. Ping-pong goes up to 2.
+	double myClock = 0.;
+	// The frames elapsed before a reset don't count.
+	bool myClockReset = false;
+
+	struct VerifyResult
+	{
+		const char* variant;
+		int64_t		numSamples;
+		double		maxAbsError;
+		int64_t		maxUlpError;
+		int64_t		nanMismatches;
+		bool		passed;
+	};
+
+	std::vector<VerifyResult> myVerifyReport;
+
+	// Scratch buffers and tables, see PHASER_ArenaBlock.
+	PhaserArena myArena;
+
+	// Sorts deferred rank rebuilds from arena blocks, so it is declared
+	// after myArena to be joined before the arena goes away.
+	PhaserWorker myRankWorker;
+
+	// Phases used when nothing is wired into the phase input.
+	float* myRampPhases = nullptr;
+	int32_t myRampSamples = -1;
+
+	// Phases of each channel as read by the kernels: the phase input, the ramp
+	// or the ranks. myPhasesHash identifies them.
+	const float* const* myPhaseChannels = nullptr;
+	uint64_t myPhasesHash = 0;
+
+	// Ranks being served, shared with other nodes ranking the same keys.
+	// They are only sorted again when the content of the phase input changes,
+	// and a deferred rebuild sorts the new ones while these are served.
+	std::shared_ptr<const PhaserPhaseTable> myRankTable;
+	PHASER_RankJob myRankJob;
+
+	// 16-bit copy of the phases, shared with other nodes reading the same phases.
+	std::shared_ptr<const PhaserPhaseTable> myPhaseTable;
+
+	// Start/end times are cached until the phases or edges change.
+	bool myTimesValid = false;
+	uint64_t myTimesPhaseHash = 0;
+	uint64_t myTimesEdgeHash = 0;
+	int32_t myTimesGroupChannel = -1;
+	double myTimesGroupEdge = 0.;
+
+	PHASER_InfoDAT myInfoDAT = PHASER_InfoDAT::Verify;
+
+	// The LOD the next cook uses when Auto LOD is on.
+	int32_t myLod = 1;
+
+	// See updateClocks.
+	const PhaserStages::Active* myClocks = nullptr;
+
+	// Value indices sorted by start and end time. Since each value only
+	// depends on t, the values that reached 0 or 1 since the previous cook
+	// are a contiguous range of one of these for each clock.
+	bool myOrderValid = false;
+	int32_t myNumEventClocks = 0;
+	int32_t myNumEvents = 0;
+
+	// Values that changed since the previous cook. The pointers are only
+	// valid during the cook that fills them in.
+	bool myPreviousValid = false;
+	int32_t myNumPreviousValues = 0;
+	int32_t* myChangedIndices = nullptr;
+	float* myChangedValues = nullptr;
+	int32_t myNumChanged = 0;
+
+	PHASER_ContentHash myPhaseHash{ PHASER_BlockPhaseChunkHashes, PHASER_BlockPhaseDirtyChunks };
+	PHASER_ContentHash myEdgeHash{ PHASER_BlockEdgeChunkHashes, PHASER_BlockEdgeDirtyChunks };
+	int64_t mySpuriousRecooks = 0;
+
+	// The values of the next cook are computed ahead of it for the t it is
+	// predicted to have, from the t of the last two cooks.
+	double mySpeculationLastT = -1.;
+	PHASER_Speculation mySpeculation;
+	PHASER_SpeculationJob mySpeculationJob;
+	// The phase input copy the speculative cook reads.
+	bool mySpeculationPhasesValid = false;
+	uint64_t mySpeculationPhasesHash = 0;
+	int64_t mySpeculationCooks = 0;
+	int64_t mySpeculationHits = 0;
+	std::atomic<bool> mySpeculationCancel{ false };
+	bool mySpeculationComplete = false;
+	// Declared after everything the job reads, so it is joined first.
+	PhaserWorker mySpeculationWorker;
+
+	float myInfoValues[PHASER_NumInfoChans];
+
+#ifdef PHASER_TRACE
+	// Where Write Trace saves the trace, from the last cook.
+	std::string myTraceFile;
+	bool myTraceFailed = false;
+#endif
 
 };
 
-enum class PHASER_OutputFormat
+// The output holds the phaser values of every phase channel, optionally
+// followed by more groups of the same size (start times, end times, velocities).
+// Multichannels swaps samples and channels of this layout.
+struct PHASER_OutputGroups
 {
-	Invalid = -1,
-	Onechannel,
-	Multichannels
+	PHASER_OutputGroups(const OP_Inputs* inputs);
+
+	// Appended to the phase channel names for the channels of 'group'.
+	const char*	suffix(int32_t group) const;
+
+	int32_t		count = 1;
+	int32_t		startTime = -1;
+	int32_t		endTime = -1;
+	int32_t		velocity = -1;
 };
@@ -0,0 +1,87 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#include "PhaserChannelNames.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+bool
+PhaserChannelNames::update(PHASER_ChannelNames scheme, const char* prefix, const OP_DATInput* dat, int32_t count)
+{
+	if (scheme != PHASER_ChannelNames::DAT)
+	{
+		dat = nullptr;
+	}
+
+	const uint32_t opId = dat ? dat->opId : 0;
+	const int64_t totalCooks = dat ? dat->totalCooks : -1;
+	if (scheme == myScheme && count == this->count() && myPrefix == prefix &&
+		opId == myOpId && totalCooks == myTotalCooks)
+	{
+		return false;
+	}
+
+	auto buildStart = std::chrono::steady_clock::now();
+
+	myScheme = scheme;
+	myPrefix = prefix;
+	myOpId = opId;
+	myTotalCooks = totalCooks;
+
+	myChars.clear();
+	myOffsets.clear();
+	myOffsets.reserve(count);
+	myChars.reserve((size_t)count * (myPrefix.size() + 8));
+
+	const int32_t numRows = dat ? dat->numRows : 0;
+	for (int32_t i = 0; i < count; i++)
+	{
+		const char* cell = i < numRows && dat->numCols > 0 ? dat->getCell(i, 0) : nullptr;
+		if (cell && cell[0])
+		{
+			append(cell);
+		}
+		else
+		{
+			appendIndexed(i + 1);
+		}
+	}
+
+	std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - buildStart;
+	myBuildMs = buildTime.count();
+	return true;
+}
+
+void
+PhaserChannelNames::append(const char* name)
+{
+	myOffsets.push_back((int32_t)myChars.size());
+	myChars.insert(myChars.end(), name, name + strlen(name) + 1);
+}
+
+void
+PhaserChannelNames::appendIndexed(int32_t number)
+{
+	myOffsets.push_back((int32_t)myChars.size());
+	myChars.insert(myChars.end(), myPrefix.begin(), myPrefix.end());
+
+	// Digits come out backwards, so they are reversed in place.
+	const size_t first = myChars.size();
+	do
+	{
+		myChars.push_back((char)('0' + number % 10));
+		number /= 10;
+	} while (number > 0);
+	std::reverse(myChars.begin() + first, myChars.end());
+	myChars.push_back('\0');
+}
@@ -0,0 +1,62 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#pragma once
+
+#include "CPlusPlus_Common.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// How the channels of a Multichannels output are named.
+enum class PHASER_ChannelNames
+{
+	Invalid = -1,
+	Index,	// prefix followed by the 1-based channel number
+	DAT		// first column of each row of a DAT, then prefix + number
+};
+
+/*
+
+ The names of the output channels, built once into a single string table and
+ kept until the number of channels or the naming scheme changes. A phase
+ input with 100k samples becomes 100k channels in Multichannels format, and
+ TouchDesigner asks for every name each time the layout cooks, so building
+ them on every call would cost more than the phaser itself.
+
+ */
+class PhaserChannelNames
+{
+public:
+	// Rebuilds the table if any of its inputs changed. Returns true if it did.
+	bool		update(PHASER_ChannelNames scheme, const char* prefix, const OP_DATInput* dat, int32_t count);
+
+	const char*	name(int32_t index) const { return myChars.data() + myOffsets[index]; }
+
+	int32_t		count() const { return (int32_t)myOffsets.size(); }
+
+	// Time taken by the last rebuild.
+	double		buildMs() const { return myBuildMs; }
+
+private:
+	void		append(const char* name);
+	void		appendIndexed(int32_t number);
+
+	// Every name followed by its terminating 0, and where each one starts.
+	std::vector<char>		myChars;
+	std::vector<int32_t>	myOffsets;
+
+	PHASER_ChannelNames	myScheme = PHASER_ChannelNames::Invalid;
+	std::string			myPrefix;
+	uint32_t			myOpId = 0;
+	int64_t				myTotalCooks = -1;
+	double				myBuildMs = 0.;
+};
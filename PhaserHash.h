@@ -0,0 +1,157 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+
+ 64-bit content hash, following the XXH64 algorithm. The main loop runs four
+ independent lanes over 32-byte stripes, which keeps the CPU busy and lets it
+ hash large phase inputs at close to memory speed.
+
+ */
+namespace PhaserHash
+{
+	const uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+	const uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+	const uint64_t Prime3 = 0x165667B19E3779F9ull;
+	const uint64_t Prime4 = 0x85EBCA77C2B2AE63ull;
+	const uint64_t Prime5 = 0x27D4EB2F165667C5ull;
+
+	inline uint64_t
+	rotl(uint64_t x, int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+
+	inline uint64_t
+	read64(const uint8_t* p)
+	{
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint32_t
+	read32(const uint8_t* p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint64_t
+	round(uint64_t acc, uint64_t input)
+	{
+		acc += input * Prime2;
+		acc = rotl(acc, 31);
+		return acc * Prime1;
+	}
+
+	inline uint64_t
+	mergeRound(uint64_t acc, uint64_t val)
+	{
+		acc ^= round(0, val);
+		return acc * Prime1 + Prime4;
+	}
+
+	inline uint64_t
+	hash(const void* data, size_t length, uint64_t seed = 0)
+	{
+		const uint8_t* p = static_cast<const uint8_t*>(data);
+		const uint8_t* const end = p + length;
+		uint64_t h;
+
+		if (length >= 32)
+		{
+			uint64_t v1 = seed + Prime1 + Prime2;
+			uint64_t v2 = seed + Prime2;
+			uint64_t v3 = seed;
+			uint64_t v4 = seed - Prime1;
+
+			const uint8_t* const limit = end - 32;
+			do
+			{
+				v1 = round(v1, read64(p));
+				v2 = round(v2, read64(p + 8));
+				v3 = round(v3, read64(p + 16));
+				v4 = round(v4, read64(p + 24));
+				p += 32;
+			} while (p <= limit);
+
+			h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+			h = mergeRound(h, v1);
+			h = mergeRound(h, v2);
+			h = mergeRound(h, v3);
+			h = mergeRound(h, v4);
+		}
+		else
+		{
+			h = seed + Prime5;
+		}
+
+		h += (uint64_t)length;
+
+		while (p + 8 <= end)
+		{
+			h ^= round(0, read64(p));
+			h = rotl(h, 27) * Prime1 + Prime4;
+			p += 8;
+		}
+
+		if (p + 4 <= end)
+		{
+			h ^= (uint64_t)read32(p) * Prime1;
+			h = rotl(h, 23) * Prime2 + Prime3;
+			p += 4;
+		}
+
+		while (p < end)
+		{
+			h ^= (*p) * Prime5;
+			h = rotl(h, 11) * Prime1;
+			p++;
+		}
+
+		h ^= h >> 33;
+		h *= Prime2;
+		h ^= h >> 29;
+		h *= Prime3;
+		h ^= h >> 32;
+		return h;
+	}
+
+	// Hashes each run of up to chunkSamples samples of every channel into
+	// chunkHashes, channel after channel. Returns a hash of the whole input
+	// made from the chunk hashes, so unchanged chunks can be found by comparing
+	// chunk hashes.
+	inline uint64_t
+	hashChunks(const float* const* channels, int32_t numChannels, int32_t numSamples,
+		int32_t chunkSamples, uint64_t* chunkHashes)
+	{
+		const int32_t chunksPerChannel = (numSamples + chunkSamples - 1) / chunkSamples;
+		for (int32_t i = 0; i < numChannels; i++)
+		{
+			for (int32_t k = 0; k < chunksPerChannel; k++)
+			{
+				const int32_t start = k * chunkSamples;
+				const int32_t count = numSamples - start < chunkSamples ? numSamples - start : chunkSamples;
+				chunkHashes[(size_t)i * chunksPerChannel + k] = hash(channels[i] + start, (size_t)count * sizeof(float));
+			}
+		}
+
+		uint64_t h = hash(&numSamples, sizeof(numSamples), (uint64_t)numChannels);
+		return hash(chunkHashes, (size_t)numChannels * chunksPerChannel * sizeof(uint64_t), h);
+	}
+}
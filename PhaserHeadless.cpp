@@ -0,0 +1,342 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+// Stand-in host for the parts of the phaser that don't need TouchDesigner.
+// It drives them headlessly with generated inputs, checks what they write
+// against PhaserKernels::phaser, and returns the number of failed checks.
+
+#include "PhaserPoints.h"
+#include "PhaserTexture.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+using PhaserKernels::Span;
+using PhaserKernels::Edges;
+
+// Prints a check and returns 1 if it failed.
+static int
+report(const char* check, const char* name, double maxError, double tolerance)
+{
+	const bool passed = maxError <= tolerance;
+	printf("%-8s %-12s max error %-12g %s\n", check, name, maxError, passed ? "pass" : "FAIL");
+	return passed ? 0 : 1;
+}
+
+struct PixelFormat
+{
+	const char*			name;
+	OP_CPUMemPixelType	type;
+	int32_t				numComponents;
+	double				tolerance;
+};
+
+// Reads component c of a pixel back as a float, undoing the swizzle of BGRA8Fixed.
+static float
+readComponent(const PixelFormat& format, const uint8_t* pixel, int32_t c)
+{
+	static const int32_t bgra[4] = { 2, 1, 0, 3 };
+	const int32_t slot = format.type == OP_CPUMemPixelType::BGRA8Fixed ? bgra[c] : c;
+
+	switch (format.type)
+	{
+		case OP_CPUMemPixelType::R32Float:
+		case OP_CPUMemPixelType::RG32Float:
+		case OP_CPUMemPixelType::RGBA32Float:
+		{
+			float value;
+			memcpy(&value, pixel + slot * sizeof(float), sizeof(value));
+			return value;
+		}
+		case OP_CPUMemPixelType::R16Float:
+		case OP_CPUMemPixelType::RG16Float:
+		case OP_CPUMemPixelType::RGBA16Float:
+		case OP_CPUMemPixelType::R16Fixed:
+		case OP_CPUMemPixelType::RG16Fixed:
+		case OP_CPUMemPixelType::RGBA16Fixed:
+		{
+			uint16_t code;
+			memcpy(&code, pixel + slot * sizeof(uint16_t), sizeof(code));
+			const bool half = format.type == OP_CPUMemPixelType::R16Float ||
+				format.type == OP_CPUMemPixelType::RG16Float || format.type == OP_CPUMemPixelType::RGBA16Float;
+			return half ? PhaserKernels::decodeHalf16(code) : PhaserKernels::decodeUnorm16(code);
+		}
+		default:
+			return pixel[slot] / 255.f;
+	}
+}
+
+// Writes every pixel format through PhaserTexture and reads the pixels back:
+// the phaser value, start and end times and 1 in the used pixels, in row
+// order or flipped, and zeroes past the last sample.
+static int
+checkTexture()
+{
+	// Rows longer than the blocks PhaserTexture converts at a time, and a
+	// last row that is only partly used.
+	const int32_t width = 300;
+	const int32_t numSamples = 3 * width + 17;
+	const double t = .6;
+
+	std::vector<float> phases(numSamples), edges(numSamples);
+	std::mt19937 rng(40);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	for (int32_t i = 0; i < numSamples; i++)
+	{
+		phases[i] = unit(rng) * 1.2f - .1f;
+		edges[i] = .05f + unit(rng);
+	}
+
+	const PixelFormat formats[] =
+	{
+		{ "BGRA8Fixed", OP_CPUMemPixelType::BGRA8Fixed, 4, .5 / 255. + 1e-6 },
+		{ "RGBA8Fixed", OP_CPUMemPixelType::RGBA8Fixed, 4, .5 / 255. + 1e-6 },
+		{ "RGBA32Float", OP_CPUMemPixelType::RGBA32Float, 4, 1e-6 },
+		{ "R8Fixed", OP_CPUMemPixelType::R8Fixed, 1, .5 / 255. + 1e-6 },
+		{ "RG8Fixed", OP_CPUMemPixelType::RG8Fixed, 2, .5 / 255. + 1e-6 },
+		{ "R32Float", OP_CPUMemPixelType::R32Float, 1, 1e-6 },
+		{ "RG32Float", OP_CPUMemPixelType::RG32Float, 2, 1e-6 },
+		{ "R16Fixed", OP_CPUMemPixelType::R16Fixed, 1, .5 / 65535. + 1e-7 },
+		{ "RG16Fixed", OP_CPUMemPixelType::RG16Fixed, 2, .5 / 65535. + 1e-7 },
+		{ "RGBA16Fixed", OP_CPUMemPixelType::RGBA16Fixed, 4, .5 / 65535. + 1e-7 },
+		{ "R16Float", OP_CPUMemPixelType::R16Float, 1, 1. / 2048. },
+		{ "RG16Float", OP_CPUMemPixelType::RG16Float, 2, 1. / 2048. },
+		{ "RGBA16Float", OP_CPUMemPixelType::RGBA16Float, 4, 1. / 2048. },
+	};
+
+	int failures = 0;
+	for (const PixelFormat& format : formats)
+	{
+		const PhaserTexture texture(numSamples, width, format.type);
+		if (!texture.valid() || texture.numComponents() != format.numComponents ||
+			texture.width() != width || texture.height() != 4)
+		{
+			failures += report("texture", format.name, INFINITY, 0.);
+			continue;
+		}
+
+		for (int32_t flip = 0; flip < 2; flip++)
+		{
+			// Filled with garbage first, so that missed pixels show up.
+			std::vector<uint8_t> pixels(texture.bytes(), 0xab);
+			texture.write(t, Span<const float>(phases.data(), numSamples), Edges(edges.data(), 0.), pixels.data(), flip != 0);
+
+			double maxError = 0.;
+			for (int32_t i = 0; i < width * texture.height(); i++)
+			{
+				const int32_t row = flip ? texture.height() - 1 - i / width : i / width;
+				const uint8_t* pixel = pixels.data() + row * texture.rowBytes() + (i % width) * texture.bytesPerPixel();
+
+				float expected[4] = { 0.f, 0.f, 0.f, 0.f };
+				if (i < numSamples)
+				{
+					const double edge = Edges(edges.data(), 0.).at(i);
+					const double phase = PhaserKernels::clamp(phases[i], 0., 1.);
+					expected[0] = PhaserKernels::phaser(t, phases[i], edge);
+					expected[1] = (float)((1. - phase) / (1. + edge));
+					expected[2] = (float)((1. - phase + edge) / (1. + edge));
+					expected[3] = 1.f;
+				}
+
+				for (int32_t c = 0; c < format.numComponents; c++)
+				{
+					const double error = std::fabs(readComponent(format, pixel, c) - expected[c]);
+					maxError = std::max(maxError, std::isnan(error) ? INFINITY : error);
+				}
+			}
+
+			failures += report(flip ? "flipped" : "texture", format.name, maxError, format.tolerance);
+		}
+	}
+
+	// A width of 0 picks a square-ish size, and unsupported formats write nothing.
+	const PhaserTexture square(10, 0, OP_CPUMemPixelType::R32Float);
+	failures += report("texture", "square", square.width() == 4 && square.height() == 3 ? 0. : INFINITY, 0.);
+
+	const PhaserTexture unsupported(numSamples, width, (OP_CPUMemPixelType)-1);
+	uint8_t untouched = 0xab;
+	unsupported.write(t, Span<const float>(phases.data(), numSamples), Edges(edges.data(), 0.), &untouched);
+	failures += report("texture", "unsupported", !unsupported.valid() && untouched == 0xab ? 0. : INFINITY, 0.);
+
+	return failures;
+}
+
+// A SOP that is just a list of points.
+class StandInSOP : public OP_SOPInput
+{
+public:
+	StandInSOP(std::vector<Position> points) : myPoints(std::move(points))
+	{
+		opPath = "/standin/sop";
+		opId = 1;
+		totalCooks = 1;
+		myPrimsInfo = nullptr;
+		myPrimPointIndices = nullptr;
+	}
+
+	int32_t		getNumPoints() const override { return (int32_t)myPoints.size(); }
+	int32_t		getNumVertices() const override { return 0; }
+	int32_t		getNumPrimitives() const override { return 0; }
+	int32_t		getNumCustomAttributes() const override { return 0; }
+	const Position*	getPointPositions() const override { return myPoints.data(); }
+	const SOP_NormalInfo*	getNormals() const override { return nullptr; }
+	const SOP_ColorInfo*	getColors() const override { return nullptr; }
+	const SOP_TextureInfo*	getTextures() const override { return nullptr; }
+	const SOP_CustomAttribData*	getCustomAttribute(int32_t) const override { return nullptr; }
+	const SOP_CustomAttribData*	getCustomAttribute(const char*) const override { return nullptr; }
+	bool		hasNormals() const override { return false; }
+	bool		hasColors() const override { return false; }
+
+	std::vector<Position>	myPoints;
+};
+
+// Largest difference between the phases of 'points' and 'expected'.
+static double
+phaseError(const PhaserPoints& points, const std::vector<float>& expected)
+{
+	if (points.numPoints() != (int32_t)expected.size())
+		return INFINITY;
+
+	double maxError = 0.;
+	for (int32_t i = 0; i < points.numPoints(); i++)
+	{
+		const double error = std::fabs(points.phases()[i] - expected[i]);
+		maxError = std::max(maxError, std::isnan(error) ? INFINITY : error);
+	}
+	return maxError;
+}
+
+// Derives point phases from a stand-in SOP in both modes, checks when they
+// are rederived, and evaluates them and their attribute.
+static int
+checkPoints()
+{
+	const int32_t numPoints = 1000;
+	std::mt19937 rng(41);
+	std::uniform_real_distribution<float> coordinate(-5.f, 5.f);
+	std::vector<Position> positions(numPoints);
+	for (Position& p : positions)
+		p = Position(coordinate(rng), coordinate(rng), coordinate(rng));
+
+	StandInSOP sop(positions);
+
+	// Phases from keys: the lowest key gets 1, the highest 0.
+	auto expectedPhases = [&](const std::vector<float>& keys, bool reverse)
+	{
+		const float lowest = *std::min_element(keys.begin(), keys.end());
+		const float highest = *std::max_element(keys.begin(), keys.end());
+		std::vector<float> phases(keys.size());
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			const float phase = highest > lowest ? 1.f - (keys[i] - lowest) / (highest - lowest) : 1.f;
+			phases[i] = reverse ? 1.f - phase : phase;
+		}
+		return phases;
+	};
+
+	PhaserPoints::Settings distance;
+	distance.origin = Position(1.f, 2.f, -3.f);
+
+	// The axis doesn't need to be normalized.
+	PhaserPoints::Settings projection;
+	projection.mode = PHASER_PointPhase::Projection;
+	projection.origin = distance.origin;
+	projection.axis = Vector(0.f, 0.f, 2.f);
+
+	std::vector<float> distances(numPoints), heights(numPoints);
+	for (int32_t i = 0; i < numPoints; i++)
+	{
+		const Position& p = positions[i];
+		const Position& o = distance.origin;
+		distances[i] = std::sqrt((p.x - o.x) * (p.x - o.x) + (p.y - o.y) * (p.y - o.y) + (p.z - o.z) * (p.z - o.z));
+		heights[i] = p.z - o.z;
+	}
+
+	int failures = 0;
+	PhaserPoints points;
+	points.update(&sop, distance);
+	failures += report("points", "distance", phaseError(points, expectedPhases(distances, false)), 1e-5);
+
+	PhaserPoints::Settings reversed = distance;
+	reversed.reverse = true;
+	points.update(&sop, reversed);
+	failures += report("points", "reverse", phaseError(points, expectedPhases(distances, true)), 1e-5);
+
+	points.update(&sop, projection);
+	failures += report("points", "projection", phaseError(points, expectedPhases(heights, false)), 1e-5);
+
+	// Moving the points without a cook keeps the phases, a cook rederives them.
+	const std::vector<float> beforeMove(points.phases().data, points.phases().data + points.numPoints());
+	for (Position& p : sop.myPoints)
+		p.z = -p.z;
+	points.update(&sop, projection);
+	failures += report("points", "kept", phaseError(points, beforeMove), 0.);
+
+	sop.totalCooks++;
+	points.update(&sop, projection);
+	failures += report("points", "cooked", phaseError(points, expectedPhases(heights, true)), 1e-5);
+
+	// A single point, or points all at the same distance, have no range.
+	const Position single(3.f, 0.f, 0.f);
+	points.update(&single, 1, distance);
+	failures += report("points", "single", phaseError(points, std::vector<float>(1, 1.f)), 0.);
+
+	const Position ring[4] = { Position(1.f, 0.f, 0.f), Position(-1.f, 0.f, 0.f), Position(0.f, 1.f, 0.f), Position(0.f, -1.f, 0.f) };
+	PhaserPoints::Settings centred;
+	centred.reverse = true;
+	points.update(ring, 4, centred);
+	failures += report("points", "no range", phaseError(points, std::vector<float>(4, 0.f)), 0.);
+
+	// Edges below SmallestEdge are raised to it, as in the CHOP.
+	points.update(&sop, distance);
+	const double edges[] = { .3, 2., 0., -1. };
+	double maxError = 0.;
+	for (double edge : edges)
+	{
+		for (double t = -.25; t <= 1.25; t += .125)
+		{
+			points.evaluate(t, edge);
+			for (int32_t i = 0; i < points.numPoints(); i++)
+			{
+				const double expected = PhaserKernels::phaser(t, points.phases()[i], std::max(PhaserKernels::SmallestEdge, edge));
+				const double error = std::fabs(points.values()[i] - expected);
+				maxError = std::max(maxError, std::isnan(error) ? INFINITY : error);
+			}
+		}
+	}
+	failures += report("points", "evaluate", maxError, 1e-6);
+
+	const SOP_CustomAttribData attribute = points.attribute("phaser");
+	const bool attributeOk = attribute.name && strcmp(attribute.name, "phaser") == 0 &&
+		attribute.numComponents == 1 && attribute.attribType == AttribType::Float &&
+		attribute.floatData == points.values().data && attribute.intData == nullptr;
+	failures += report("points", "attribute", attributeOk ? 0. : INFINITY, 0.);
+
+	points.update((const OP_SOPInput*)nullptr, distance);
+	failures += report("points", "no input", points.numPoints() == 0 ? 0. : INFINITY, 0.);
+
+	return failures;
+}
+
+int
+main()
+{
+	int failures = 0;
+	failures += checkTexture();
+	failures += checkPoints();
+
+	printf("%d failed\n", failures);
+	return failures;
+}
@@ -0,0 +1,492 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+/*
+
+ The phaser math and the loops that evaluate it over many samples, with no
+ dependency on the TouchDesigner API, so they can be reused by other plugins
+ or offline tools and benchmarked on their own. PhaserCHOP only gathers its
+ inputs into spans and hands them to these.
+
+ Every kernel reads and writes contiguous spans. Edges are either a span of
+ one edge per sample or a single scalar edge. Output layouts that aren't
+ contiguous (like the swapped channels and samples of Multi-Channel) are
+ written afterwards with store() or scatter().
+
+ */
+namespace PhaserKernels
+{
+	// Edges smaller than this are raised to it.
+	const double SmallestEdge = 1. / 65536.; // 2^-16
+
+	// A pointer and a number of elements.
+	template <typename T>
+	struct Span
+	{
+		Span() = default;
+		Span(T* d, int32_t n) : data(d), size(n) {}
+
+		// Spans of T convert to spans of const T.
+		template <typename U>
+		Span(const Span<U>& other) : data(other.data), size(other.size) {}
+
+		T&		operator[](int32_t i) const { return data[i]; }
+
+		Span	subspan(int32_t offset, int32_t count) const { return Span(data + offset, count); }
+
+		T*		data = nullptr;
+		int32_t	size = 0;
+	};
+
+	// One edge per sample, or 'scalar' for every sample when 'data' is null.
+	// Per-sample edges are raised to SmallestEdge, the scalar is used as is.
+	struct Edges
+	{
+		Edges(double e) : scalar(e) {}
+		Edges(const float* d, double e) : data(d), scalar(e) {}
+
+		double	at(int32_t i) const { return data ? std::max(SmallestEdge, (double)data[i]) : scalar; }
+
+		Edges	subspan(int32_t offset) const { return Edges(data ? data + offset : nullptr, scalar); }
+
+		const float*	data = nullptr;
+		double			scalar;
+	};
+
+	inline float
+	clamp(double val, double lower, double upper)
+	{
+		return val <= lower ? lower : val >= upper ? upper : val;
+	}
+
+	// An alternative easing function.
+	// A typical easing function called "ease" takes a value "t" from [0,1] and returns another value [0,1]
+	// where ease(0)=0, ease(1)=1.
+	// Imagine we have multiple unique objects that are being animated from 0 to 1 and then processed through "ease".
+	// We may want to stagger the way in which these objects go through "ease", and this is why we use the "phaser" function.
+	// Phaser takes an additional argument called "phase", which is from [0,1]. A value of 1 corresponds to an animated object that
+	// "ahead of the pack"; It will start animating before others. A value of 0 for phase corresponds to an object that is late; It
+	// will be the last to start moving. The "edge" parameter describes the cohesiveness of the pack of animated objects; A small value
+	// will cause the objects to go through the animation very differently, or very sharply. A small value is a sharper edge.
+	// The output of the phaser function will be [0,1], so these values can then be passed to any other easing function, perhaps "smoothstep",
+	// or "ease-in-out".
+	inline float
+	phaser(double t, double _phase, double edge)
+	{
+		// safety checks because phase must be [0-1].
+		float phase = clamp(_phase, 0., 1.);
+		// but we will assume t has been clamped to [0,1] before entering this function.
+		// We will also assume edge is greater than and not equal to 0.
+
+		// smaller edge corresponds to sharper separation according
+		// to differences in phase
+		return clamp((-1. + phase + t*(1. + edge)) / edge, 0., 1.);
+	}
+
+	// Precomputed form of phaser for a fixed t and edge:
+	// phaser(t, phase, edge) == clamp(phase * scale + offset, 0, 1)
+	struct Coefficients
+	{
+		Coefficients(double t, double edge) :
+			scale(1. / edge),
+			offset((t * (1. + edge) - 1.) / edge)
+		{
+		}
+
+		float
+		evaluate(double phase) const
+		{
+			phase = phase <= 0. ? 0. : phase >= 1. ? 1. : phase;
+			double v = phase * scale + offset;
+			return (float)(v <= 0. ? 0. : v >= 1. ? 1. : v);
+		}
+
+		double scale;
+		double offset;
+	};
+
+	// Phases are clamped to [0,1] before they are stored in 16 bits.
+	inline uint16_t
+	encodeUnorm16(float phase)
+	{
+		// NaN is stored as 0.
+		phase = phase > 0.f ? (phase < 1.f ? phase : 1.f) : 0.f;
+		return (uint16_t)(phase * 65535.f + .5f);
+	}
+
+	inline float
+	decodeUnorm16(uint16_t code)
+	{
+		return code * (1.f / 65535.f);
+	}
+
+	// IEEE half float conversions with round to nearest even.
+	inline uint16_t
+	encodeHalf16(float value)
+	{
+		uint32_t f;
+		memcpy(&f, &value, sizeof(f));
+
+		const uint32_t sign = f & 0x80000000u;
+		f ^= sign;
+
+		uint16_t h;
+		if (f >= (143u << 23))
+		{
+			// Overflow becomes infinity, NaN stays NaN.
+			h = f > (255u << 23) ? 0x7e00 : 0x7c00;
+		}
+		else if (f < (113u << 23))
+		{
+			// Denormal half, let the FPU do the rounding.
+			const uint32_t magicBits = 126u << 23;
+			float magic, shifted;
+			memcpy(&magic, &magicBits, sizeof(magic));
+			memcpy(&shifted, &f, sizeof(shifted));
+			shifted += magic;
+			memcpy(&f, &shifted, sizeof(f));
+			h = (uint16_t)(f - magicBits);
+		}
+		else
+		{
+			const uint32_t mantissaOdd = (f >> 13) & 1;
+			// Rebias the exponent from 127 to 15, shifting unsigned.
+			f -= 112u << 23;
+			f += 0xfff + mantissaOdd;
+			h = (uint16_t)(f >> 13);
+		}
+
+		return h | (uint16_t)(sign >> 16);
+	}
+
+	inline float
+	decodeHalf16(uint16_t h)
+	{
+		const uint32_t shiftedExponent = 0x7c00u << 13;
+		uint32_t f = (h & 0x7fffu) << 13;
+		const uint32_t exponent = f & shiftedExponent;
+		f += (127u - 15u) << 23;
+
+		float value;
+		if (exponent == shiftedExponent)
+		{
+			// Infinity or NaN
+			f += (128u - 16u) << 23;
+			memcpy(&value, &f, sizeof(value));
+		}
+		else if (exponent == 0)
+		{
+			// Zero or denormal
+			f += 1u << 23;
+			const uint32_t magicBits = 113u << 23;
+			float magic;
+			memcpy(&magic, &magicBits, sizeof(magic));
+			memcpy(&value, &f, sizeof(value));
+			value -= magic;
+		}
+		else
+		{
+			memcpy(&value, &f, sizeof(value));
+		}
+
+		return (h & 0x8000u) ? -value : value;
+	}
+
+	// Kernels evaluate phaser(t, phases[i], edges.at(i)) into each of the
+	// out.size elements of 'out'.
+	typedef void (*Kernel)(double t, Span<const float> phases, Edges edges, Span<float> out);
+
+	inline void
+	reference(double t, Span<const float> phases, Edges edges, Span<float> out)
+	{
+		for (int32_t i = 0; i < out.size; i++)
+		{
+			out[i] = phaser(t, phases[i], edges.at(i));
+		}
+	}
+
+	// Same result as reference, but the division by edge is hoisted out of
+	// the sample loop when the edge is a scalar.
+	template <typename Decode, typename Phase>
+	inline void
+	coefficientDecoded(double t, Span<const Phase> phases, Edges edges, Span<float> out, Decode decode)
+	{
+		if (edges.data)
+		{
+			for (int32_t i = 0; i < out.size; i++)
+			{
+				out[i] = Coefficients(t, edges.at(i)).evaluate(decode(phases[i]));
+			}
+			return;
+		}
+
+		const Coefficients coeffs(t, edges.scalar);
+		for (int32_t i = 0; i < out.size; i++)
+		{
+			out[i] = coeffs.evaluate(decode(phases[i]));
+		}
+	}
+
+	inline void
+	coefficient(double t, Span<const float> phases, Edges edges, Span<float> out)
+	{
+		coefficientDecoded(t, phases, edges, out, [](float phase) { return phase; });
+	}
+
+	// The 16-bit kernels decode each phase in registers.
+	inline void
+	coefficientUnorm16(double t, Span<const uint16_t> codes, Edges edges, Span<float> out)
+	{
+		coefficientDecoded(t, codes, edges, out, decodeUnorm16);
+	}
+
+	inline void
+	coefficientHalf16(double t, Span<const uint16_t> codes, Edges edges, Span<float> out)
+	{
+		coefficientDecoded(t, codes, edges, out, decodeHalf16);
+	}
+
+	// Float phase versions of the 16-bit kernels, which encode a chunk at a
+	// time. Mostly useful to compare them with the other kernels.
+	template <uint16_t (*Encode)(float), void (*Evaluate)(double, Span<const uint16_t>, Edges, Span<float>)>
+	inline void
+	encoded(double t, Span<const float> phases, Edges edges, Span<float> out)
+	{
+		uint16_t codes[256];
+		for (int32_t start = 0; start < out.size; start += 256)
+		{
+			int32_t count = std::min(256, out.size - start);
+			for (int32_t i = 0; i < count; i++)
+				codes[i] = Encode(phases[start + i]);
+			Evaluate(t, Span<const uint16_t>(codes, count), edges.subspan(start), out.subspan(start, count));
+		}
+	}
+
+	inline void
+	unorm16(double t, Span<const float> phases, Edges edges, Span<float> out)
+	{
+		encoded<encodeUnorm16, coefficientUnorm16>(t, phases, edges, out);
+	}
+
+	inline void
+	half16(double t, Span<const float> phases, Edges edges, Span<float> out)
+	{
+		encoded<encodeHalf16, coefficientHalf16>(t, phases, edges, out);
+	}
+
+	// Two-level phaser: the progress of each sample's group,
+	// phaser(t, groupPhases[i], groupEdge), is the t of its member phaser
+	// phaser(progress, phases[i], edges.at(i)). Members of a group are expected
+	// next to each other, so the group progress and the member coefficients are
+	// only recomputed where the group phase changes.
+	template <typename Decode, typename Phase>
+	inline void
+	hierarchicalDecoded(double t, Span<const float> groupPhases, double groupEdge,
+		Span<const Phase> phases, Edges edges, Span<float> out, Decode decode)
+	{
+		const Coefficients group(t, groupEdge);
+		double progress = 0.;
+		Coefficients coeffs(progress, edges.scalar);
+		for (int32_t i = 0; i < out.size; i++)
+		{
+			if (i == 0 || groupPhases[i] != groupPhases[i - 1])
+			{
+				progress = group.evaluate(groupPhases[i]);
+				coeffs = Coefficients(progress, edges.scalar);
+			}
+
+			if (edges.data)
+			{
+				out[i] = Coefficients(progress, edges.at(i)).evaluate(decode(phases[i]));
+			}
+			else
+			{
+				out[i] = coeffs.evaluate(decode(phases[i]));
+			}
+		}
+	}
+
+	inline void
+	hierarchical(double t, Span<const float> groupPhases, double groupEdge,
+		Span<const float> phases, Edges edges, Span<float> out)
+	{
+		hierarchicalDecoded(t, groupPhases, groupEdge, phases, edges, out, [](float phase) { return phase; });
+	}
+
+	inline void
+	hierarchicalUnorm16(double t, Span<const float> groupPhases, double groupEdge,
+		Span<const uint16_t> codes, Edges edges, Span<float> out)
+	{
+		hierarchicalDecoded(t, groupPhases, groupEdge, codes, edges, out, decodeUnorm16);
+	}
+
+	inline void
+	hierarchicalHalf16(double t, Span<const float> groupPhases, double groupEdge,
+		Span<const uint16_t> codes, Edges edges, Span<float> out)
+	{
+		hierarchicalDecoded(t, groupPhases, groupEdge, codes, edges, out, decodeHalf16);
+	}
+
+	// The t at which each phase starts moving and reaches 1.
+	inline void
+	startEndTimes(Span<const float> phases, Edges edges, Span<float> tstart, Span<float> tend)
+	{
+		// phaser starts moving once -1 + phase + t*(1 + edge) reaches 0,
+		// and reaches 1 once it reaches edge.
+		for (int32_t i = 0; i < tstart.size; i++)
+		{
+			double e = edges.at(i);
+			double scale = 1. / (1. + e);
+			double phase = clamp(phases[i], 0., 1.);
+			tstart[i] = (float)((1. - phase) * scale);
+			tend[i] = (float)((1. - phase + e) * scale);
+		}
+	}
+
+	// Level of detail: evaluates every step-th value, and the last one, with
+	// evaluate(i) and fills the values in between linearly.
+	template <typename Evaluate>
+	inline void
+	decimated(Span<float> out, int32_t step, Evaluate evaluate)
+	{
+		if (out.size == 0)
+			return;
+
+		int32_t a = 0;
+		float va = evaluate(0);
+		out[0] = va;
+		while (a < out.size - 1)
+		{
+			const int32_t b = std::min(a + step, out.size - 1);
+			const float vb = evaluate(b);
+			const float slope = (vb - va) / (float)(b - a);
+			for (int32_t i = a + 1; i < b; i++)
+			{
+				out[i] = va + slope * (float)(i - a);
+			}
+			out[b] = vb;
+			a = b;
+			va = vb;
+		}
+	}
+
+	template <typename Decode, typename Phase>
+	inline void
+	coefficientLod(double t, Span<const Phase> phases, Edges edges, Span<float> out, int32_t step, Decode decode)
+	{
+		const Coefficients coeffs(t, edges.scalar);
+		decimated(out, step, [&](int32_t i)
+		{
+			return edges.data ? Coefficients(t, edges.at(i)).evaluate(decode(phases[i])) : coeffs.evaluate(decode(phases[i]));
+		});
+	}
+
+	template <typename Decode, typename Phase>
+	inline void
+	hierarchicalLod(double t, Span<const float> groupPhases, double groupEdge,
+		Span<const Phase> phases, Edges edges, Span<float> out, int32_t step, Decode decode)
+	{
+		const Coefficients group(t, groupEdge);
+		decimated(out, step, [&](int32_t i)
+		{
+			return Coefficients(group.evaluate(groupPhases[i]), edges.at(i)).evaluate(decode(phases[i]));
+		});
+	}
+
+	// Turns the member start/end times of a hierarchical phaser, which are
+	// group progresses, into the t at which the group reaches them.
+	inline void
+	hierarchicalTimes(Span<const float> groupPhases, double groupEdge, Span<float> tstart, Span<float> tend)
+	{
+		// The group progress x is reached at t = (x*edge + 1 - phase)/(1 + edge).
+		const double scale = 1. / (1. + groupEdge);
+		for (int32_t i = 0; i < tstart.size; i++)
+		{
+			double offset = (1. - clamp(groupPhases[i], 0., 1.)) * scale;
+			tstart[i] = (float)(tstart[i] * groupEdge * scale + offset);
+			tend[i] = (float)(tend[i] * groupEdge * scale + offset);
+		}
+	}
+
+	// d(phaser)/dt of the values a kernel wrote: (1 + edge)/edge while moving, 0 otherwise.
+	inline void
+	velocities(Span<const float> values, Edges edges, Span<float> out)
+	{
+		// phaser is linear in t with slope (1 + edge)/edge until it is clamped.
+		float slope = (float)((1. + edges.scalar) / edges.scalar);
+		for (int32_t i = 0; i < out.size; i++)
+		{
+			if (edges.data)
+			{
+				double e = edges.at(i);
+				slope = (float)((1. + e) / e);
+			}
+			out[i] = values[i] > 0.f && values[i] < 1.f ? slope : 0.f;
+		}
+	}
+
+	// values = offset + values * scale
+	inline void
+	scale(Span<float> values, float scale, float offset)
+	{
+		for (int32_t i = 0; i < values.size; i++)
+		{
+			values[i] = offset + values[i] * scale;
+		}
+	}
+
+	// Adds the values that have reached 1 and the values strictly between 0 and 1.
+	inline void
+	countProgress(Span<const float> values, int64_t& finished, int64_t& moving)
+	{
+		int32_t f = 0;
+		int32_t m = 0;
+		for (int32_t i = 0; i < values.size; i++)
+		{
+			f += values[i] >= 1.f;
+			m += values[i] > 0.f && values[i] < 1.f;
+		}
+		finished += f;
+		moving += m;
+	}
+
+	// Writes 'values' every 'stride' floats from 'dst'.
+	inline void
+	store(Span<const float> values, float* dst, ptrdiff_t stride)
+	{
+		if (stride == 1)
+		{
+			memcpy(dst, values.data, values.size * sizeof(float));
+			return;
+		}
+		for (int32_t i = 0; i < values.size; i++)
+		{
+			dst[i * stride] = values[i];
+		}
+	}
+
+	// Writes values[i] to rows[i][column], for outputs that keep one array per sample.
+	inline void
+	scatter(Span<const float> values, float* const* rows, int32_t column)
+	{
+		for (int32_t i = 0; i < values.size; i++)
+		{
+			rows[i][column] = values[i];
+		}
+	}
+}
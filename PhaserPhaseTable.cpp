@@ -0,0 +1,232 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+#include "PhaserPhaseTable.h"
+#include "PhaserSort.h"
+#include "PhaserTrace.h"
+
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+
+// The cache only holds weak references, so a table goes away with
+// the last node that uses it.
+static std::mutex cacheMutex;
+static std::map<PhaserPhaseTable::Key, std::weak_ptr<const PhaserPhaseTable>> cache;
+
+// Returns the cached table for 'key', or null. The cache must be locked.
+static std::shared_ptr<const PhaserPhaseTable>
+cached(const PhaserPhaseTable::Key& key)
+{
+	auto it = cache.find(key);
+	return it != cache.end() ? it->second.lock() : nullptr;
+}
+
+// Drops the tables nobody uses anymore. The cache must be locked.
+static void
+dropExpired()
+{
+	for (auto stale = cache.begin(); stale != cache.end();)
+	{
+		stale = stale->second.expired() ? cache.erase(stale) : std::next(stale);
+	}
+}
+
+bool
+PhaserPhaseTable::Key::operator<(const Key& other) const
+{
+	return std::tie(contentHash, numChannels, numSamples, storage, ranked) <
+		std::tie(other.contentHash, other.numChannels, other.numSamples, other.storage, other.ranked);
+}
+
+std::shared_ptr<const PhaserPhaseTable>
+PhaserPhaseTable::find(const Key& key)
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	return cached(key);
+}
+
+std::shared_ptr<const PhaserPhaseTable>
+PhaserPhaseTable::acquireRanks(const Key& key, const float* const* channels,
+	int32_t* order, uint32_t* bits, uint32_t* bitsScratch, int32_t* orderScratch)
+{
+	std::shared_ptr<const PhaserPhaseTable> table = find(key);
+	if (table)
+	{
+		return table;
+	}
+
+	std::shared_ptr<PhaserPhaseTable> ranks = std::make_shared<PhaserPhaseTable>(key);
+	ranks->allocate();
+	ranks->buildRanks(channels, order, bits, bitsScratch, orderScratch);
+
+	// Another node may have sorted the same keys meanwhile.
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	table = cached(key);
+	if (table)
+	{
+		return table;
+	}
+
+	dropExpired();
+	cache[key] = ranks;
+	return ranks;
+}
+
+std::shared_ptr<const PhaserPhaseTable>
+PhaserPhaseTable::acquire(const Key& key, const float* const* channels,
+	std::shared_ptr<const PhaserPhaseTable> previous,
+	const int32_t* dirtyChunks, int32_t numDirtyChunks)
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+
+	std::shared_ptr<const PhaserPhaseTable> found = cached(key);
+	if (found)
+	{
+		return found;
+	}
+
+	dropExpired();
+
+	const bool canPatch = previous && dirtyChunks &&
+		previous->myKey.numChannels == key.numChannels &&
+		previous->myKey.numSamples == key.numSamples &&
+		previous->myKey.storage == key.storage &&
+		previous->myKey.ranked == key.ranked;
+
+	std::shared_ptr<PhaserPhaseTable> table;
+	if (canPatch && previous.use_count() == 1)
+	{
+		// Nobody else can get hold of 'previous' while the cache is locked,
+		// so it can be changed in place and filed under its new key.
+		table = std::const_pointer_cast<PhaserPhaseTable>(previous);
+		cache.erase(table->myKey);
+		table->myKey = key;
+	}
+	else if (canPatch)
+	{
+		table = std::make_shared<PhaserPhaseTable>(key);
+		table->allocate();
+		memcpy(table->myCodes, previous->myCodes, (size_t)key.numChannels * key.numSamples * sizeof(uint16_t));
+		memcpy(table->myChunkErrors, previous->myChunkErrors, (size_t)table->numChunks() * sizeof(float));
+	}
+
+	if (table)
+	{
+		for (int32_t i = 0; i < numDirtyChunks; i++)
+		{
+			table->buildChunk(channels, dirtyChunks[i]);
+		}
+	}
+	else
+	{
+		table = std::make_shared<PhaserPhaseTable>(key);
+		table->allocate();
+		for (int32_t chunk = 0; chunk < table->numChunks(); chunk++)
+		{
+			table->buildChunk(channels, chunk);
+		}
+	}
+
+	table->updateMaxError();
+	cache[key] = table;
+	return table;
+}
+
+PhaserPhaseTable::PhaserPhaseTable(const Key& key) :
+	myKey(key),
+	myStorage(NumBlocks),
+	myCodes(nullptr),
+	myChunkErrors(nullptr),
+	myRanks(nullptr),
+	myMaxError(0.f)
+{
+}
+
+void
+PhaserPhaseTable::allocate()
+{
+	const size_t numValues = (size_t)myKey.numChannels * myKey.numSamples;
+	if (myKey.storage == PHASER_PhaseStorage::Float32)
+	{
+		myRanks = myStorage.get<float>(BlockRanks, numValues);
+	}
+	else
+	{
+		myCodes = myStorage.get<uint16_t>(BlockCodes, numValues);
+		myChunkErrors = myStorage.get<float>(BlockChunkErrors, numChunks());
+	}
+}
+
+void
+PhaserPhaseTable::buildRanks(const float* const* channels,
+	int32_t* order, uint32_t* bits, uint32_t* bitsScratch, int32_t* orderScratch)
+{
+	PHASER_TRACE_SCOPE("buildRanks");
+
+	// Equal keys keep their input order, so ties still get distinct phases.
+	const int32_t numSamples = myKey.numSamples;
+	const double scale = numSamples > 1 ? 1. / (double)(numSamples - 1) : 0.;
+	for (int32_t i = 0; i < myKey.numChannels; i++)
+	{
+		PhaserSort::argsort(channels[i], numSamples, order, bits, bitsScratch, orderScratch);
+
+		float* rank = myRanks + (size_t)i * numSamples;
+		for (int32_t k = 0; k < numSamples; k++)
+		{
+			rank[order[k]] = numSamples > 1 ? (float)(k * scale) : 0.5f;
+		}
+	}
+}
+
+void
+PhaserPhaseTable::buildChunk(const float* const* channels, int32_t chunk)
+{
+	const int32_t channel = chunk / chunksPerChannel();
+	const int32_t start = (chunk % chunksPerChannel()) * ChunkSamples;
+	const int32_t end = std::min(start + ChunkSamples, myKey.numSamples);
+
+	const float* phases = channels[channel];
+	uint16_t* codes = myCodes + (size_t)channel * myKey.numSamples;
+	float maxError = 0.f;
+
+	for (int32_t j = start; j < end; j++)
+	{
+		// phaser clamps the phase to [0,1] anyway, so that's all we need to store.
+		// NaN is stored as 0.
+		float phase = phases[j] > 0.f ? (phases[j] < 1.f ? phases[j] : 1.f) : 0.f;
+		float decoded;
+		if (myKey.storage == PHASER_PhaseStorage::Unorm16)
+		{
+			codes[j] = PhaserKernels::encodeUnorm16(phase);
+			decoded = PhaserKernels::decodeUnorm16(codes[j]);
+		}
+		else
+		{
+			codes[j] = PhaserKernels::encodeHalf16(phase);
+			decoded = PhaserKernels::decodeHalf16(codes[j]);
+		}
+		maxError = std::max(maxError, std::fabs(decoded - phase));
+	}
+
+	myChunkErrors[chunk] = maxError;
+}
+
+void
+PhaserPhaseTable::updateMaxError()
+{
+	myMaxError = 0.f;
+	for (int32_t chunk = 0; chunk < numChunks(); chunk++)
+	{
+		myMaxError = std::max(myMaxError, myChunkErrors[chunk]);
+	}
+}
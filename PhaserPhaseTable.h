@@ -0,0 +1,122 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <memory>
+
+#include "PhaserArena.h"
+#include "PhaserKernels.h"
+
+// How phases are stored for the kernel.
+enum class PHASER_PhaseStorage
+{
+	Invalid = -1,
+	Float32,
+	Unorm16,
+	Half16
+};
+
+/*
+
+ Tables that are derived only from the phase input. They don't depend on
+ pct or edge, so every PhaserCHOP reading the same phase data can share one
+ read-only copy through a process-wide cache. Tables are keyed by the content
+ of the phases, so a recook that doesn't change the phases keeps its table.
+
+ Phases are handled in chunks of ChunkSamples samples of a channel. When only
+ a few chunks of the phases change, only those chunks are rebuilt.
+
+ Ranked tables are made from the rank of each phase within its channel
+ instead. A Float32 ranked table holds the ranks themselves, sorted once for
+ every node reading the same keys, and the 16-bit ranked tables are built
+ from those ranks.
+
+ */
+class PhaserPhaseTable
+{
+public:
+	struct Key
+	{
+		// Content hash of the phases, see PhaserHash::hashChunks
+		uint64_t			contentHash;
+		int32_t				numChannels;
+		int32_t				numSamples;
+		PHASER_PhaseStorage	storage;
+		// Made from the ranks of the phases rather than the phases, see acquireRanks.
+		bool				ranked = false;
+
+		bool operator<(const Key& other) const;
+	};
+
+	static const int32_t ChunkSamples = 4096;
+
+	// Returns the table for 'key', building it from 'channels' if no other
+	// node holds it. 'channels' holds key.numChannels arrays of key.numSamples phases.
+	//
+	// If 'previous' is a table of the same size and storage, and 'dirtyChunks'
+	// lists every chunk whose phases differ from it, only those chunks are built.
+	// 'previous' is patched in place when the caller held the last reference to it.
+	static std::shared_ptr<const PhaserPhaseTable> acquire(const Key& key, const float* const* channels,
+		std::shared_ptr<const PhaserPhaseTable> previous = nullptr,
+		const int32_t* dirtyChunks = nullptr, int32_t numDirtyChunks = 0);
+
+	// Returns the table for 'key' if a node holds it already, or null.
+	static std::shared_ptr<const PhaserPhaseTable> find(const Key& key);
+
+	// Returns the ranks for a ranked Float32 'key', sorting the keys in
+	// 'channels' if no other node holds them. The sort doesn't hold up other
+	// nodes using the cache. The scratch arrays hold key.numSamples elements
+	// each, see PhaserSort::argsort.
+	static std::shared_ptr<const PhaserPhaseTable> acquireRanks(const Key& key, const float* const* channels,
+		int32_t* order, uint32_t* bits, uint32_t* bitsScratch, int32_t* orderScratch);
+
+	PhaserPhaseTable(const Key& key);
+
+	const Key&		key() const { return myKey; }
+
+	// 16-bit phases, channel after channel
+	const uint16_t*	codes(int32_t channel) const { return myCodes + (size_t)channel * myKey.numSamples; }
+
+	// Ranks scaled to [0, 1], channel after channel, for ranked Float32 tables
+	const float*	ranks(int32_t channel) const { return myRanks + (size_t)channel * myKey.numSamples; }
+
+	// The largest difference between a stored phase and its clamped source phase.
+	float			maxError() const { return myMaxError; }
+
+	size_t			bytes() const { return myStorage.bytesReserved(); }
+
+	int32_t			numChunks() const { return myKey.numChannels * chunksPerChannel(); }
+	int32_t			chunksPerChannel() const { return (myKey.numSamples + ChunkSamples - 1) / ChunkSamples; }
+
+private:
+	void			allocate();
+	void			buildChunk(const float* const* channels, int32_t chunk);
+	void			buildRanks(const float* const* channels,
+						int32_t* order, uint32_t* bits, uint32_t* bitsScratch, int32_t* orderScratch);
+	void			updateMaxError();
+
+	enum
+	{
+		BlockCodes,
+		BlockChunkErrors,
+		BlockRanks,
+		NumBlocks
+	};
+
+	Key				myKey;
+	PhaserArena		myStorage;
+	uint16_t*		myCodes;
+	float*			myChunkErrors;
+	float*			myRanks;
+	float			myMaxError;
+};
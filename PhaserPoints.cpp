@@ -0,0 +1,104 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#include "PhaserPoints.h"
+
+#include <cmath>
+#include <algorithm>
+
+bool
+PhaserPoints::Settings::operator!=(const Settings& other) const
+{
+	return mode != other.mode || reverse != other.reverse ||
+		origin.x != other.origin.x || origin.y != other.origin.y || origin.z != other.origin.z ||
+		axis.x != other.axis.x || axis.y != other.axis.y || axis.z != other.axis.z;
+}
+
+PhaserPoints::PhaserPoints() : myArena(NumBlocks)
+{
+}
+
+void
+PhaserPoints::update(const OP_SOPInput* sop, const Settings& settings)
+{
+	if (!sop)
+	{
+		myNumPoints = 0;
+		myTotalCooks = -1;
+		return;
+	}
+
+	if (sop->opId == myOpId && sop->totalCooks == myTotalCooks && !(settings != mySettings))
+		return;
+
+	myOpId = sop->opId;
+	myTotalCooks = sop->totalCooks;
+	update(sop->getPointPositions(), sop->getNumPoints(), settings);
+}
+
+void
+PhaserPoints::update(const Position* positions, int32_t numPoints, const Settings& settings)
+{
+	mySettings = settings;
+	myNumPoints = std::max(0, numPoints);
+	myPhases = myArena.get<float>(BlockPhases, myNumPoints);
+	myValues = myArena.get<float>(BlockValues, myNumPoints);
+	derivePhases(positions);
+}
+
+void
+PhaserPoints::derivePhases(const Position* positions)
+{
+	const Position& o = mySettings.origin;
+	Vector axis = mySettings.axis;
+	axis.normalize();
+
+	// The raw distances go in myPhases first, then are normalized in place.
+	float lowest = INFINITY;
+	float highest = -INFINITY;
+	for (int32_t i = 0; i < myNumPoints; i++)
+	{
+		const Vector d(positions[i].x - o.x, positions[i].y - o.y, positions[i].z - o.z);
+		float key;
+		if (mySettings.mode == PHASER_PointPhase::Projection)
+			key = d.dot(axis);
+		else
+			key = std::sqrt(d.dot(d));
+
+		myPhases[i] = key;
+		lowest = std::min(lowest, key);
+		highest = std::max(highest, key);
+	}
+
+	// Nearest first: the lowest key gets a phase of 1.
+	const float range = highest - lowest;
+	const float scale = range > 0.f ? 1.f / range : 0.f;
+	for (int32_t i = 0; i < myNumPoints; i++)
+	{
+		float phase = 1.f - (myPhases[i] - lowest) * scale;
+		myPhases[i] = mySettings.reverse ? 1.f - phase : phase;
+	}
+}
+
+void
+PhaserPoints::evaluate(double t, double edge)
+{
+	edge = std::max(PhaserKernels::SmallestEdge, edge);
+	PhaserKernels::coefficient(t, phases(), edge, PhaserKernels::Span<float>(myValues, myNumPoints));
+}
+
+SOP_CustomAttribData
+PhaserPoints::attribute(const char* name) const
+{
+	SOP_CustomAttribData data(name, 1, AttribType::Float);
+	data.floatData = myValues;
+	return data;
+}
@@ -0,0 +1,91 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#pragma once
+
+#include "CPlusPlus_Common.h"
+#include "PhaserArena.h"
+#include "PhaserKernels.h"
+#include <stdint.h>
+
+// How a point's phase is derived from its position.
+enum class PHASER_PointPhase
+{
+	Invalid = -1,
+	Distance,	// distance from the origin
+	Projection	// position along the axis through the origin
+};
+
+/*
+
+ Runs the phaser over the points of a SOP, so point clouds don't need a
+ round trip through CHOP channels. Phases come from the point positions:
+ the points closest to the origin (or furthest back along the axis) get a
+ phase of 1 and move first, the furthest get 0. The phases only depend on
+ the positions, so they are kept until the SOP cooks or the settings change.
+
+ The values are written as a one-component float point attribute, ready to
+ hand to a SOP output as a custom attribute.
+
+ */
+class PhaserPoints
+{
+public:
+	struct Settings
+	{
+		PHASER_PointPhase	mode = PHASER_PointPhase::Distance;
+		Position			origin;
+		Vector				axis = Vector(0.f, 1.f, 0.f);
+		// Makes the furthest points move first.
+		bool				reverse = false;
+
+		bool operator!=(const Settings& other) const;
+	};
+
+	PhaserPoints();
+
+	// Rederives the phases if 'sop' has cooked or the settings changed.
+	void		update(const OP_SOPInput* sop, const Settings& settings);
+
+	// Same, for positions that don't come from a SOP. They are always reread.
+	void		update(const Position* positions, int32_t numPoints, const Settings& settings);
+
+	// Evaluates phaser for every point into the attribute values.
+	void		evaluate(double t, double edge);
+
+	int32_t		numPoints() const { return myNumPoints; }
+
+	PhaserKernels::Span<const float>	phases() const { return PhaserKernels::Span<const float>(myPhases, myNumPoints); }
+	PhaserKernels::Span<const float>	values() const { return PhaserKernels::Span<const float>(myValues, myNumPoints); }
+
+	// The values as a point attribute called 'name'.
+	SOP_CustomAttribData	attribute(const char* name) const;
+
+private:
+	void		derivePhases(const Position* positions);
+
+	enum Block
+	{
+		BlockPhases,
+		BlockValues,
+		NumBlocks
+	};
+
+	PhaserArena	myArena;
+
+	float*		myPhases = nullptr;
+	float*		myValues = nullptr;
+	int32_t		myNumPoints = 0;
+
+	Settings	mySettings;
+	uint32_t	myOpId = 0;
+	int64_t		myTotalCooks = -1;
+};
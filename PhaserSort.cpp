@@ -0,0 +1,167 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#include "PhaserSort.h"
+#include "PhaserTrace.h"
+
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static const int32_t RadixBits = 8;
+static const int32_t RadixSize = 1 << RadixBits;
+static const int32_t MaxThreads = 8;
+
+// Flips the bits of a float so that unsigned comparison orders them like floats.
+static uint32_t
+sortableBits(float f)
+{
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	return u ^ ((u >> 31) ? 0xffffffffu : 0x80000000u);
+}
+
+// Holds each of 'count' threads in wait() until all of them have reached it.
+class SortBarrier
+{
+public:
+	explicit SortBarrier(int32_t count) : myCount(count) {}
+
+	void
+	wait()
+	{
+		std::unique_lock<std::mutex> lock(myMutex);
+		const uint32_t generation = myGeneration;
+		if (++myArrived == myCount)
+		{
+			myArrived = 0;
+			myGeneration++;
+			myReleased.notify_all();
+			return;
+		}
+		myReleased.wait(lock, [&]() { return myGeneration != generation; });
+	}
+
+private:
+	std::mutex				myMutex;
+	std::condition_variable	myReleased;
+	const int32_t			myCount;
+	int32_t					myArrived = 0;
+	uint32_t				myGeneration = 0;
+};
+
+void
+PhaserSort::argsort(const float* keys, int32_t n, int32_t* order,
+	uint32_t* bits, uint32_t* bitsScratch, int32_t* orderScratch)
+{
+	if (n <= 0)
+		return;
+
+	int32_t numThreads = 1;
+	if (n >= ParallelThreshold)
+	{
+		numThreads = std::max(1, std::min((int32_t)std::thread::hardware_concurrency(), MaxThreads));
+	}
+
+	// The threads are started once and run every pass over their own range
+	// of the input, meeting at the barrier between the steps of a pass.
+	int32_t counts[MaxThreads][RadixSize];
+	SortBarrier barrier(numThreads);
+	bool sameDigit = false;
+
+	auto sortRange = [&](int32_t thread, int32_t begin, int32_t end)
+	{
+		PHASER_TRACE_SCOPE("sort range");
+
+		uint32_t* from = bits;
+		uint32_t* to = bitsScratch;
+		int32_t* fromOrder = order;
+		int32_t* toOrder = orderScratch;
+
+		for (int32_t i = begin; i < end; i++)
+		{
+			from[i] = sortableBits(keys[i]);
+			fromOrder[i] = i;
+		}
+		barrier.wait();
+
+		for (int32_t shift = 0; shift < 32; shift += RadixBits)
+		{
+			int32_t* count = counts[thread];
+			std::fill(count, count + RadixSize, 0);
+			for (int32_t i = begin; i < end; i++)
+			{
+				count[(from[i] >> shift) & (RadixSize - 1)]++;
+			}
+			barrier.wait();
+
+			if (thread == 0)
+			{
+				// Skip digits that are the same for every key.
+				const uint32_t digit = (from[0] >> shift) & (RadixSize - 1);
+				int32_t total = 0;
+				for (int32_t t = 0; t < numThreads; t++)
+					total += counts[t][digit];
+				sameDigit = total == n;
+
+				// Turn the counts into where each thread writes each digit, in
+				// digit order and then thread order so that the sort stays stable.
+				int32_t offset = 0;
+				for (int32_t d = 0; d < RadixSize && !sameDigit; d++)
+				{
+					for (int32_t t = 0; t < numThreads; t++)
+					{
+						const int32_t c = counts[t][d];
+						counts[t][d] = offset;
+						offset += c;
+					}
+				}
+			}
+			barrier.wait();
+
+			if (sameDigit)
+				continue;
+
+			int32_t* next = counts[thread];
+			for (int32_t i = begin; i < end; i++)
+			{
+				const int32_t at = next[(from[i] >> shift) & (RadixSize - 1)]++;
+				to[at] = from[i];
+				toOrder[at] = fromOrder[i];
+			}
+			barrier.wait();
+
+			std::swap(from, to);
+			std::swap(fromOrder, toOrder);
+		}
+
+		// After an odd number of passes the result is in the caller's scratch.
+		if (fromOrder != order)
+		{
+			memcpy(order + begin, fromOrder + begin, (end - begin) * sizeof(int32_t));
+		}
+	};
+
+	std::thread threads[MaxThreads];
+	for (int32_t t = 1; t < numThreads; t++)
+	{
+		const int32_t begin = (int32_t)((int64_t)n * t / numThreads);
+		const int32_t end = (int32_t)((int64_t)n * (t + 1) / numThreads);
+		threads[t] = std::thread(sortRange, t, begin, end);
+	}
+	sortRange(0, 0, (int32_t)((int64_t)n / numThreads));
+	for (int32_t t = 1; t < numThreads; t++)
+	{
+		threads[t].join();
+	}
+}
@@ -0,0 +1,37 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+
+ Argsort of float keys with a least significant digit radix sort: four
+ stable passes over 8-bit digits of the keys' bits, reordered so that they
+ compare like the floats. Large inputs are split across threads, each
+ counting and then scattering its own range of the input.
+
+ NaNs sort after +infinity (or before -infinity when their sign bit is set).
+ Equal keys keep their input order.
+
+ */
+namespace PhaserSort
+{
+	// Fills 'order' with the indices of 'keys' from the smallest key to the
+	// largest. The scratch arrays hold n elements each.
+	void	argsort(const float* keys, int32_t n, int32_t* order,
+				uint32_t* bits, uint32_t* bitsScratch, int32_t* orderScratch);
+
+	// Below this many keys the sort runs on the calling thread.
+	const int32_t ParallelThreshold = 1 << 16;
+}
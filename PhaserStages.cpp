@@ -0,0 +1,111 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#include "PhaserStages.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+static int32_t
+findColumn(const OP_DATInput* dat, const char* name)
+{
+	for (int32_t col = 0; col < dat->numCols; col++)
+	{
+		if (!strcmp(dat->getCell(0, col), name))
+			return col;
+	}
+	return -1;
+}
+
+static double
+cellValue(const OP_DATInput* dat, int32_t row, int32_t col, double defaultValue)
+{
+	if (col < 0)
+		return defaultValue;
+
+	const char* cell = dat->getCell(row, col);
+	char* end = nullptr;
+	double value = strtod(cell, &end);
+	return end != cell ? value : defaultValue;
+}
+
+bool
+PhaserStages::update(const OP_DATInput* dat)
+{
+	if (!dat || !dat->isTable)
+	{
+		myStages.clear();
+		myTotalCooks = -1;
+		return false;
+	}
+
+	if (dat->opId == myOpId && dat->totalCooks == myTotalCooks)
+		return !myStages.empty();
+
+	myOpId = dat->opId;
+	myTotalCooks = dat->totalCooks;
+	myStages.clear();
+
+	const int32_t start = findColumn(dat, "start");
+	const int32_t end = findColumn(dat, "end");
+	if (start < 0 || end < 0)
+		return false;
+
+	const int32_t edge = findColumn(dat, "edge");
+	const int32_t from = findColumn(dat, "from");
+	const int32_t to = findColumn(dat, "to");
+
+	for (int32_t row = 1; row < dat->numRows; row++)
+	{
+		Stage stage;
+		stage.start = cellValue(dat, row, start, 0.);
+		stage.end = std::max(stage.start, cellValue(dat, row, end, 1.));
+		stage.edge = cellValue(dat, row, edge, 0.);
+		stage.from = (float)cellValue(dat, row, from, 0.);
+		stage.to = (float)cellValue(dat, row, to, 1.);
+		myStages.push_back(stage);
+	}
+
+	std::stable_sort(myStages.begin(), myStages.end(),
+		[](const Stage& a, const Stage& b) { return a.start < b.start; });
+
+	return !myStages.empty();
+}
+
+PhaserStages::Active
+PhaserStages::evaluate(double t, double edge) const
+{
+	// The last stage that has started, or the first one before any has.
+	size_t index = 0;
+	while (index + 1 < myStages.size() && myStages[index + 1].start <= t)
+		index++;
+
+	const Stage& stage = myStages[index];
+	const double duration = stage.end - stage.start;
+
+	Active active;
+	if (duration > 0.)
+	{
+		active.t = std::min(std::max((t - stage.start) / duration, 0.), 1.);
+	}
+	else
+	{
+		// A zero length stage is a step.
+		active.t = t >= stage.start ? 1. : 0.;
+	}
+	active.edge = stage.edge > 0. ? stage.edge : edge;
+	active.from = stage.from;
+	active.range = stage.to - stage.from;
+	active.velocityScale = duration > 0. && t >= stage.start && t <= stage.end ?
+		(float)(active.range / duration) : 0.f;
+	return active;
+}
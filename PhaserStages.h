@@ -0,0 +1,72 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#pragma once
+
+#include "CPlusPlus_Common.h"
+#include <stdint.h>
+#include <vector>
+
+/*
+
+ A keyframed phaser read from a table DAT, one stage per row:
+
+   start  end  edge  from  to
+   0      0.2  0.5   0     1
+   0.5    0.8  2     1     0
+
+ 'start' and 'end' are the window of pct the stage plays in. Within it, pct
+ is remapped to 0..1 and fed to phaser with the stage's edge, and the result
+ is mapped from 'from' to 'to'. Between stages the last stage that started
+ holds its end value. Columns are found by name in the first row; 'edge',
+ 'from' and 'to' are optional and default to the Edge parameter, 0 and 1.
+
+ Since pct is the same for every sample, only one stage is active per cook,
+ and evaluating it is a single pass over the samples.
+
+ */
+class PhaserStages
+{
+public:
+	// What the active stage does to a cook.
+	struct Active
+	{
+		double		t;			// pct remapped into the stage window
+		double		edge;
+		float		from;
+		float		range;		// to - from
+		// d(stage t)/d(pct) times range, to scale the phaser velocity by.
+		float		velocityScale;
+	};
+
+	// Reparses 'dat' if it has cooked since the last call.
+	// Returns false if 'dat' doesn't hold a usable stage table.
+	bool		update(const OP_DATInput* dat);
+
+	Active		evaluate(double t, double edge) const;
+
+	int32_t		numStages() const { return (int32_t)myStages.size(); }
+
+private:
+	struct Stage
+	{
+		double		start;
+		double		end;
+		double		edge;	// <= 0 means the Edge parameter
+		float		from;
+		float		to;
+	};
+
+	std::vector<Stage>	myStages;
+
+	uint32_t	myOpId = 0;
+	int64_t		myTotalCooks = -1;
+};
@@ -0,0 +1,146 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#include "PhaserTexture.h"
+
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+
+using PhaserKernels::Span;
+using PhaserKernels::Edges;
+
+PhaserTexture::PhaserTexture(int32_t numSamples, int32_t width, OP_CPUMemPixelType pixelType) :
+	myNumSamples(std::max(0, numSamples)),
+	myPixelType(pixelType)
+{
+	if (width <= 0)
+	{
+		width = std::max(1, (int32_t)std::ceil(std::sqrt((double)myNumSamples)));
+	}
+	myWidth = width;
+	myHeight = std::max(1, (myNumSamples + width - 1) / width);
+
+	switch (pixelType)
+	{
+		case OP_CPUMemPixelType::BGRA8Fixed:
+		case OP_CPUMemPixelType::RGBA8Fixed:	myNumComponents = 4; myBytesPerComponent = 1; break;
+		case OP_CPUMemPixelType::R8Fixed:		myNumComponents = 1; myBytesPerComponent = 1; break;
+		case OP_CPUMemPixelType::RG8Fixed:		myNumComponents = 2; myBytesPerComponent = 1; break;
+		case OP_CPUMemPixelType::R16Fixed:		myNumComponents = 1; myBytesPerComponent = 2; break;
+		case OP_CPUMemPixelType::RG16Fixed:		myNumComponents = 2; myBytesPerComponent = 2; break;
+		case OP_CPUMemPixelType::RGBA16Fixed:	myNumComponents = 4; myBytesPerComponent = 2; break;
+		case OP_CPUMemPixelType::R16Float:		myNumComponents = 1; myBytesPerComponent = 2; break;
+		case OP_CPUMemPixelType::RG16Float:		myNumComponents = 2; myBytesPerComponent = 2; break;
+		case OP_CPUMemPixelType::RGBA16Float:	myNumComponents = 4; myBytesPerComponent = 2; break;
+		case OP_CPUMemPixelType::R32Float:		myNumComponents = 1; myBytesPerComponent = 4; break;
+		case OP_CPUMemPixelType::RG32Float:		myNumComponents = 2; myBytesPerComponent = 4; break;
+		case OP_CPUMemPixelType::RGBA32Float:	myNumComponents = 4; myBytesPerComponent = 4; break;
+		default:								myNumComponents = 0; myBytesPerComponent = 0; break;
+	}
+}
+
+void
+PhaserTexture::write(double t, Span<const float> phases, Edges edges, void* pixels, bool flipVertical) const
+{
+	if (!valid())
+		return;
+
+	// Rows are converted a block of pixels at a time from these.
+	const int32_t BlockPixels = 256;
+	float values[BlockPixels];
+	float tstart[BlockPixels];
+	float tend[BlockPixels];
+	float ones[BlockPixels];
+	std::fill(ones, ones + BlockPixels, 1.f);
+	const float* components[4] = { values, tstart, tend, ones };
+
+	uint8_t* dst = static_cast<uint8_t*>(pixels);
+	for (int32_t y = 0; y < myHeight; y++)
+	{
+		uint8_t* row = dst + rowBytes() * (flipVertical ? myHeight - 1 - y : y);
+		const int32_t rowStart = y * myWidth;
+		const int32_t rowSamples = std::min(myWidth, std::max(0, myNumSamples - rowStart));
+
+		for (int32_t x = 0; x < rowSamples; x += BlockPixels)
+		{
+			const int32_t start = rowStart + x;
+			const int32_t n = std::min(BlockPixels, rowSamples - x);
+			const Span<const float> blockPhases = phases.subspan(start, n);
+			const Edges blockEdges = edges.subspan(start);
+
+			PhaserKernels::coefficient(t, blockPhases, blockEdges, Span<float>(values, n));
+			if (myNumComponents > 1)
+			{
+				PhaserKernels::startEndTimes(blockPhases, blockEdges, Span<float>(tstart, n), Span<float>(tend, n));
+			}
+			storeRow(components, n, row + x * bytesPerPixel());
+		}
+
+		memset(row + rowSamples * bytesPerPixel(), 0, (myWidth - rowSamples) * bytesPerPixel());
+	}
+}
+
+void
+PhaserTexture::storeRow(const float* const* components, int32_t count, uint8_t* dst) const
+{
+	// BGRA8Fixed stores the first component third.
+	static const int32_t bgra[4] = { 2, 1, 0, 3 };
+	const bool swizzle = myPixelType == OP_CPUMemPixelType::BGRA8Fixed;
+
+	for (int32_t c = 0; c < myNumComponents; c++)
+	{
+		const float* src = components[c];
+		const int32_t slot = swizzle ? bgra[c] : c;
+
+		switch (myPixelType)
+		{
+			case OP_CPUMemPixelType::R32Float:
+			case OP_CPUMemPixelType::RG32Float:
+			case OP_CPUMemPixelType::RGBA32Float:
+			{
+				float* out = reinterpret_cast<float*>(dst) + slot;
+				for (int32_t i = 0; i < count; i++)
+					out[i * myNumComponents] = src[i];
+				break;
+			}
+			case OP_CPUMemPixelType::R16Float:
+			case OP_CPUMemPixelType::RG16Float:
+			case OP_CPUMemPixelType::RGBA16Float:
+			{
+				uint16_t* out = reinterpret_cast<uint16_t*>(dst) + slot;
+				for (int32_t i = 0; i < count; i++)
+					out[i * myNumComponents] = PhaserKernels::encodeHalf16(src[i]);
+				break;
+			}
+			case OP_CPUMemPixelType::R16Fixed:
+			case OP_CPUMemPixelType::RG16Fixed:
+			case OP_CPUMemPixelType::RGBA16Fixed:
+			{
+				// Every component is in [0,1], which is what unorm16 holds.
+				uint16_t* out = reinterpret_cast<uint16_t*>(dst) + slot;
+				for (int32_t i = 0; i < count; i++)
+					out[i * myNumComponents] = PhaserKernels::encodeUnorm16(src[i]);
+				break;
+			}
+			default:
+			{
+				uint8_t* out = dst + slot;
+				for (int32_t i = 0; i < count; i++)
+				{
+					float v = src[i] > 0.f ? (src[i] < 1.f ? src[i] : 1.f) : 0.f;
+					out[i * myNumComponents] = (uint8_t)(v * 255.f + .5f);
+				}
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,66 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#pragma once
+
+#include "CPlusPlus_Common.h"
+#include "PhaserKernels.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+
+ Writes phaser values straight into a packed 2D pixel buffer in one of the
+ OP_CPUMemPixelType formats, for uploading as a texture that drives GPU
+ instancing. Sample i goes to pixel (i % width, i / width), so there is no
+ CHOP reshaping on the way to the GPU.
+
+ The first component of each pixel holds the phaser value. If the format has
+ more, they hold the start time, the end time and 1, so a shader can tell
+ where each instance is in its transition. Pixels past the last sample are
+ zeroed.
+
+ This only depends on plain buffers, so it can be driven by a TOP, by
+ another plugin or by a stand-in host in a headless test.
+
+ */
+class PhaserTexture
+{
+public:
+	// A width of 0 picks the smallest square-ish size that fits numSamples.
+	PhaserTexture(int32_t numSamples, int32_t width, OP_CPUMemPixelType pixelType);
+
+	// False if the pixel type isn't supported.
+	bool		valid() const { return myBytesPerComponent > 0; }
+
+	int32_t		width() const { return myWidth; }
+	int32_t		height() const { return myHeight; }
+	int32_t		numComponents() const { return myNumComponents; }
+	size_t		bytesPerPixel() const { return (size_t)myNumComponents * myBytesPerComponent; }
+	size_t		rowBytes() const { return bytesPerPixel() * myWidth; }
+	size_t		bytes() const { return rowBytes() * myHeight; }
+
+	// Evaluates phaser for every sample and writes the pixels. 'pixels' holds
+	// bytes() bytes. With flipVertical the first row of samples is written last.
+	void		write(double t, PhaserKernels::Span<const float> phases, PhaserKernels::Edges edges,
+					void* pixels, bool flipVertical = false) const;
+
+private:
+	// Converts 'count' pixels worth of components to the pixel format.
+	void		storeRow(const float* const* components, int32_t count, uint8_t* dst) const;
+
+	int32_t				myNumSamples;
+	int32_t				myWidth;
+	int32_t				myHeight;
+	OP_CPUMemPixelType	myPixelType;
+	int32_t				myNumComponents = 0;
+	size_t				myBytesPerComponent = 0;
+};
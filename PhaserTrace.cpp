@@ -0,0 +1,143 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+
+#include "PhaserTrace.h"
+
+#ifdef PHASER_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+
+struct TraceEvent
+{
+	const char*	name;
+	int64_t		start;
+	int64_t		duration;
+};
+
+// Only its thread writes to a ring. 'count' is published after each span so
+// that write() never reads one that is half done, unless it was overwritten.
+struct TraceRing
+{
+	int32_t					id = 0;
+	std::atomic<uint64_t>	count{ 0 };
+	TraceEvent				events[PhaserTrace::RingEvents];
+};
+
+// Rings outlive their threads and are handed to the next thread that
+// traces, since workers come and go every job.
+struct TraceRegistry
+{
+	std::mutex				mutex;
+	std::vector<TraceRing*>	rings;
+	std::vector<TraceRing*>	freeRings;
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+// Never destroyed, so threads that end after static destruction can still
+// give their rings back.
+static TraceRegistry&
+registry()
+{
+	static TraceRegistry* r = new TraceRegistry;
+	return *r;
+}
+
+struct TraceThread
+{
+	~TraceThread()
+	{
+		if (ring)
+		{
+			std::lock_guard<std::mutex> lock(registry().mutex);
+			registry().freeRings.push_back(ring);
+		}
+	}
+
+	TraceRing*	ring = nullptr;
+};
+
+static thread_local TraceThread traceThread;
+
+static TraceRing*
+threadRing()
+{
+	if (!traceThread.ring)
+	{
+		TraceRegistry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		if (r.freeRings.empty())
+		{
+			TraceRing* ring = new TraceRing;
+			ring->id = (int32_t)r.rings.size() + 1;
+			r.rings.push_back(ring);
+			r.freeRings.push_back(ring);
+		}
+		traceThread.ring = r.freeRings.back();
+		r.freeRings.pop_back();
+	}
+	return traceThread.ring;
+}
+
+static int64_t
+now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - registry().epoch).count();
+}
+
+PhaserTrace::Scope::Scope(const char* name) : myName(name), myStart(now())
+{
+}
+
+PhaserTrace::Scope::~Scope()
+{
+	TraceRing* ring = threadRing();
+	const uint64_t count = ring->count.load(std::memory_order_relaxed);
+	ring->events[count % RingEvents] = { myName, myStart, now() - myStart };
+	ring->count.store(count + 1, std::memory_order_release);
+}
+
+bool
+PhaserTrace::write(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	TraceRegistry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+
+	// Complete ("X") events, in microseconds.
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (const TraceRing* ring : r.rings)
+	{
+		const uint64_t count = ring->count.load(std::memory_order_acquire);
+		const uint64_t begin = count > (uint64_t)RingEvents ? count - RingEvents : 0;
+		for (uint64_t i = begin; i < count; i++)
+		{
+			const TraceEvent& e = ring->events[i % RingEvents];
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				first ? "" : ",\n", e.name, ring->id, e.start / 1000., e.duration / 1000.);
+			first = false;
+		}
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	return fclose(file) == 0;
+}
+
+#endif
@@ -0,0 +1,62 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+
+ Scoped timers for profiling, compiled in only when PHASER_TRACE is defined.
+ Each thread records the spans of its PHASER_TRACE_SCOPE()s into its own ring
+ buffer, without locks, and write() exports the rings as a Chrome trace JSON
+ file for chrome://tracing or Perfetto. Without PHASER_TRACE the macro expands
+ to nothing.
+
+ */
+#ifdef PHASER_TRACE
+
+namespace PhaserTrace
+{
+	// Spans kept per thread. Once full, the oldest ones are overwritten.
+	const int32_t RingEvents = 1 << 16;
+
+	// Records the time between its construction and destruction. 'name' must
+	// stay valid until the trace is written, so it is a string literal.
+	class Scope
+	{
+	public:
+		explicit Scope(const char* name);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char*	myName;
+		int64_t		myStart;
+	};
+
+	// Writes the spans of every thread to 'path'. Returns false if the file
+	// can't be written. Threads still recording may overwrite their oldest
+	// spans while they are written out.
+	bool	write(const char* path);
+}
+
+#define PHASER_TRACE_CONCAT2(a, b) a##b
+#define PHASER_TRACE_CONCAT(a, b) PHASER_TRACE_CONCAT2(a, b)
+#define PHASER_TRACE_SCOPE(name) PhaserTrace::Scope PHASER_TRACE_CONCAT(phaserTraceScope, __LINE__)(name)
+
+#else
+
+#define PHASER_TRACE_SCOPE(name)
+
+#endif
@@ -0,0 +1,85 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#include "PhaserWorker.h"
+
+PhaserWorker::PhaserWorker()
+{
+}
+
+PhaserWorker::~PhaserWorker()
+{
+	wait();
+	{
+		std::lock_guard<std::mutex> lock(myMutex);
+		myQuit = true;
+	}
+	myWake.notify_one();
+	if (myThread.joinable())
+	{
+		myThread.join();
+	}
+}
+
+void
+PhaserWorker::start(Job job, void* context)
+{
+	wait();
+	if (!myThread.joinable())
+	{
+		myThread = std::thread(&PhaserWorker::run, this);
+	}
+	{
+		std::lock_guard<std::mutex> lock(myMutex);
+		myJob = job;
+		myContext = context;
+		myQueued = true;
+		myDone.store(false, std::memory_order_relaxed);
+	}
+	myPending = true;
+	myWake.notify_one();
+}
+
+void
+PhaserWorker::wait()
+{
+	std::unique_lock<std::mutex> lock(myMutex);
+	myFinished.wait(lock, [this]() { return myDone.load(std::memory_order_relaxed); });
+}
+
+void
+PhaserWorker::collect()
+{
+	wait();
+	myPending = false;
+}
+
+void
+PhaserWorker::run()
+{
+	std::unique_lock<std::mutex> lock(myMutex);
+	for (;;)
+	{
+		myWake.wait(lock, [this]() { return myQueued || myQuit; });
+		if (!myQueued)
+			return;
+
+		myQueued = false;
+		Job job = myJob;
+		void* context = myContext;
+		lock.unlock();
+		job(context);
+		lock.lock();
+
+		myDone.store(true, std::memory_order_release);
+		myFinished.notify_all();
+	}
+}
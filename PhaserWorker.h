@@ -0,0 +1,71 @@
+/* Shared Use License: This file is owned by Derivative Inc. (Derivative) and
+ * can only be used, and/or modified for use, in conjunction with
+ * Derivative's TouchDesigner software, and only if you are a licensee who has
+ * accepted Derivative's TouchDesigner license or assignment agreement (which
+ * also govern the use of this file).  You may share a modified version of this
+ * file with another authorized licensee of Derivative's TouchDesigner software.
+ * Otherwise, no redistribution or sharing of this file, with or without
+ * modification, is permitted.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/*
+
+ Runs one job at a time on a background thread, for rebuilds that shouldn't
+ stall the cook. The job writes into memory its owner set aside for it (a
+ back buffer), and the owner swaps that in once done() says the job has
+ returned, so nothing is shared while the job runs.
+
+ The thread is started by the first job and sleeps between jobs, so nodes
+ that never run one don't hold an idle thread. A job is a plain function and
+ a context pointer, so starting one after the first allocates nothing.
+
+ */
+class PhaserWorker
+{
+public:
+	typedef void (*Job)(void* context);
+
+	PhaserWorker();
+	~PhaserWorker();
+
+	PhaserWorker(const PhaserWorker&) = delete;
+	PhaserWorker& operator=(const PhaserWorker&) = delete;
+
+	// Runs job(context) on the worker thread, after waiting for the previous job.
+	// The first call starts the thread.
+	void		start(Job job, void* context);
+
+	// True from start() until collect().
+	bool		pending() const { return myPending; }
+
+	// True once the job has returned. Never blocks.
+	bool		done() const { return myDone.load(std::memory_order_acquire); }
+
+	// Blocks until the job has returned.
+	void		wait();
+
+	// Waits for the job and marks its result as taken.
+	void		collect();
+
+private:
+	void		run();
+
+	std::mutex				myMutex;
+	std::condition_variable	myWake;
+	std::condition_variable	myFinished;
+	Job						myJob = nullptr;
+	void*					myContext = nullptr;
+	bool					myQueued = false;
+	bool					myQuit = false;
+	std::atomic<bool>		myDone{ true };
+	bool					myPending = false;
+	std::thread				myThread;
+};